@@ -0,0 +1,279 @@
+// make bench: microbenchmarks for the core game systems. Results go to stdout as JSON
+// (ns/op and allocations/op per benchmark) so runs can be compared across commits.
+//
+// The game is compiled into this binary with its main() left out, which gives the benchmarks
+// direct access to the static systems in main.c. The Makefile links with
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so every allocation made by game code is
+// counted (allocations inside the SDL libraries themselves are not seen).
+#define GAME_NO_MAIN
+#include "../src/main.c"
+
+#define BENCH_MIN_SECONDS 0.25 // each benchmark runs at least this long
+#define BENCH_MAP_TXT "bench_map.txt"
+#define BENCH_MAP_BIN "bench_map.lvlb"
+#define BENCH_MAP_META "bench_map.meta"
+#define BENCH_LIGHTS 48 // dynamic lights per lighting frame
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+static long long alloc_count = 0;
+
+void* __wrap_malloc(size_t size) { alloc_count++; return __real_malloc(size); }
+void* __wrap_calloc(size_t count, size_t size) { alloc_count++; return __real_calloc(count, size); }
+void* __wrap_realloc(void* p, size_t size) { alloc_count++; return __real_realloc(p, size); }
+
+static int bench_first = 1;
+
+// run fn with a growing op count until it takes BENCH_MIN_SECONDS, then report the last run
+static void bench(const char* name, void (*fn)(int n)) {
+    long long n = 1;
+    for (;;) {
+        long long allocs = alloc_count;
+        Uint64 t0 = SDL_GetPerformanceCounter();
+        fn((int)n);
+        double secs = (double)(SDL_GetPerformanceCounter() - t0) / (double)SDL_GetPerformanceFrequency();
+        allocs = alloc_count - allocs;
+        if (secs >= BENCH_MIN_SECONDS || n >= (1 << 30)) {
+            fprintf(stdout, "%s\n  {\"name\":\"%s\",\"ops\":%lld,\"ns_per_op\":%.1f,\"allocs_per_op\":%.3f}",
+                    bench_first ? "" : ",", name, n, secs * 1e9 / (double)n, (double)allocs / (double)n);
+            fflush(stdout);
+            bench_first = 0;
+            return;
+        }
+        // aim a little past the minimum so the next run is usually the last
+        long long next = secs > 1e-4 ? (long long)(n * 1.2 * BENCH_MIN_SECONDS / secs) + 1 : n * 10;
+        n = next > n ? next : n + 1;
+        if (n > (1 << 30)) n = 1 << 30;
+    }
+}
+
+// rows x cols map: wall border, scattered wall tiles, an NPC every npc_every cells, player in the middle
+static int write_map(const char* path, int rows, int cols, int npc_every) {
+    FILE* f = fopen(path, "w");
+    if (!f) return FALSE;
+    unsigned int seed = 12345;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            seed = seed * 1103515245u + 12345u;
+            const char* cell = "00";
+            if (r == 0 || c == 0 || r == rows - 1 || c == cols - 1) cell = "01";
+            else if (r == rows / 2 && c == cols / 2) cell = "P";
+            else if (npc_every > 0 && (seed >> 16) % npc_every == 0) cell = "A(hp=5)";
+            else if ((seed >> 16) % 23 == 0) cell = "02";
+            fprintf(f, "%s%s", cell, c < cols - 1 ? " " : "\n");
+        }
+    }
+    fclose(f);
+    return TRUE;
+}
+
+// --- level loading ---
+
+static const char* load_path = BENCH_MAP_TXT;
+
+static void bench_load_level(int n) {
+    for (int i = 0; i < n; ++i) load_level(load_path);
+}
+
+// --- collision ---
+
+#define BENCH_POINTS 4096
+static float point_x[BENCH_POINTS], point_y[BENCH_POINTS];
+
+// random positions inside the resident window
+static void make_points(void) {
+    float x0 = (float)(world.cc0 * WORLD_CHUNK_TILES * TILE_SIZE), y0 = (float)(world.cr0 * WORLD_CHUNK_TILES * TILE_SIZE);
+    float w = (float)((world.cc1 - world.cc0 + 1) * WORLD_CHUNK_TILES * TILE_SIZE) - 32.0f;
+    float h = (float)((world.cr1 - world.cr0 + 1) * WORLD_CHUNK_TILES * TILE_SIZE) - 32.0f;
+    for (int i = 0; i < BENCH_POINTS; ++i) {
+        point_x[i] = x0 + (float)(rand() % 10000) / 10000.0f * w;
+        point_y[i] = y0 + (float)(rand() % 10000) / 10000.0f * h;
+    }
+}
+
+static volatile int bench_sink;
+
+static void bench_rect_solid(int n) {
+    int hits = 0;
+    for (int i = 0; i < n; ++i) hits += world_rect_solid(point_x[i & (BENCH_POINTS - 1)], point_y[i & (BENCH_POINTS - 1)], 24, 31);
+    bench_sink = hits;
+}
+
+// a typical per-tick step, and a 40px spike step that has to sweep two tiles
+static float move_step = 1.5f;
+
+static void bench_move_and_slide(int n) {
+    int hits = 0;
+    for (int i = 0; i < n; ++i) {
+        int k = i & (BENCH_POINTS - 1);
+        WorldMove m = world_move_and_slide(point_x[k], point_y[k], 24, 31, (k & 1) ? move_step : -move_step, (k & 2) ? move_step : -move_step);
+        hits += m.hit_x + m.hit_y;
+    }
+    bench_sink = hits;
+}
+
+// --- inventory ---
+
+static void bench_inventory(int n) {
+    static const char* ids[] = { "C01", "C02", "C03", "W01", "C01", "W02", "C02", "W01" };
+    init_inventories();
+    for (int i = 0; i < n; ++i) {
+        Item it; clear_item(&it);
+        strncpy(it.id, ids[i & 7], sizeof(it.id)-1);
+        it.type = it.id[0] == 'C' ? ITEM_CARD : ITEM_WEAPON;
+        it.stack = 1; it.max_stack = 3;
+        // full: start over so every op is a real stacking attempt
+        if (!add_item_to_inventory(it)) init_inventories();
+    }
+}
+
+// --- NPC update and render ---
+
+// replace the level's NPCs with count neutral ones spread over the resident window
+static void populate_npcs(int count) {
+    npc_clear();
+    for (int k = 0; k < count; ++k) {
+        int i = npc_spawn();
+        if (i < 0) break;
+        float x, y;
+        do {
+            x = point_x[rand() % BENCH_POINTS]; y = point_y[rand() % BENCH_POINTS];
+        } while (world_rect_solid(x, y, 24, 31));
+        npcs.x[i] = npcs.prev_x[i] = x; npcs.y[i] = npcs.prev_y[i] = y;
+        npcs.width[i] = 24; npcs.height[i] = 31;
+        npcs.hp[i] = 5; npcs.speed[i] = 20.0f;
+        npc_cold[i].id = 'A'; npc_cold[i].max_hp = 5;
+        npc_cold[i].anim = entity_anim('A');
+    }
+    spatial_reserve(&npc_grid, npcs.capacity);
+    spatial_reset(&npc_grid, npc_grid.origin_x, npc_grid.origin_y, npc_grid.rows, npc_grid.cols);
+    for (int i = 0; i < npcs.count; ++i) spatial_insert(&npc_grid, i, npcs.x[i] + npcs.width[i]/2.0f, npcs.y[i] + npcs.height[i]/2.0f);
+}
+
+static void bench_update(int n) {
+    // no keyboard: the player stands still and only the NPCs move
+    int was_headless = headless;
+    headless = 1;
+    for (int i = 0; i < n; ++i) update(1.0f / (float)SIM_TICK_RATE, 0);
+    headless = was_headless;
+}
+
+static void bench_render(int n) {
+    for (int i = 0; i < n; ++i) render();
+}
+
+// the whole game state into a snapshot, and back (a rewind step)
+static Snapshot bench_snap;
+
+static void bench_snapshot_save(int n) {
+    for (int i = 0; i < n; ++i) save_state(&bench_snap);
+}
+
+static void bench_snapshot_restore(int n) {
+    for (int i = 0; i < n; ++i) restore_state(&bench_snap);
+}
+
+// a drop spawned and picked up again, with the pool half full of other drops
+static void bench_drop_cycle(int n) {
+    for (int i = 0; i < n; ++i) {
+        spawn_drop("C01", point_x[i & (BENCH_POINTS - 1)], point_y[i & (BENCH_POINTS - 1)]);
+        remove_drop(i % drops.count);
+    }
+}
+
+// a static light every 8 tiles around the middle of the map
+static int write_lights(const char* path, int rows, int cols) {
+    FILE* f = fopen(path, "w");
+    if (!f) return FALSE;
+    for (int r = rows / 2 - 32; r <= rows / 2 + 32; r += 8)
+        for (int c = cols / 2 - 48; c <= cols / 2 + 48; c += 8) fprintf(f, "%d,%d: light, radius=6, color=ffd0a0\n", r, c);
+    return fclose(f) == 0;
+}
+
+// one frame's light map over the screen: static lights plus BENCH_LIGHTS dynamic ones
+static void bench_lighting(int n) {
+    int r0 = (int)(player.y / TILE_SIZE) - WINDOW_HEIGHT / TILE_SIZE / 2, c0 = (int)(player.x / TILE_SIZE) - WINDOW_WIDTH / TILE_SIZE / 2;
+    for (int i = 0; i < n; ++i) {
+        light_begin(r0, c0, WINDOW_HEIGHT / TILE_SIZE + 2, WINDOW_WIDTH / TILE_SIZE + 2);
+        for (int k = 0; k < BENCH_LIGHTS; ++k)
+            light_add(player.x + (float)(k % 8 - 4) * 192.0f, player.y + (float)(k / 8 - 3) * 160.0f, LIGHT_TORCH_RADIUS, (SDL_Color){ 255, 200, 140, 255 });
+        light_draw(renderer, 0.0f, 0.0f, TILE_SIZE);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    (void)argc; (void)argv;
+    if (SDL_Init(SDL_INIT_TIMER) != 0) {
+        fprintf(stderr, "Error initializing SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+    IMG_Init(IMG_INIT_PNG);
+    // render() draws into a software renderer on an offscreen surface: no window or GPU needed
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    renderer = target ? SDL_CreateSoftwareRenderer(target) : NULL;
+    if (!renderer) {
+        fprintf(stderr, "Error creating software renderer: %s\n", SDL_GetError());
+        return 1;
+    }
+    srand(1);
+    if (!write_map(BENCH_MAP_TXT, 512, 512, 40)) {
+        fprintf(stderr, "Could not write %s\n", BENCH_MAP_TXT);
+        return 1;
+    }
+    remove(BENCH_MAP_BIN);
+    start_level = BENCH_MAP_TXT;
+    setup();
+
+    fprintf(stdout, "{\"benchmarks\":[");
+    bench("load_level/txt_512x512", bench_load_level);
+    LevelData lv;
+    if (level_parse_text(BENCH_MAP_TXT, &lv)) {
+        level_write_binary(&lv, BENCH_MAP_BIN);
+        level_free(&lv);
+        load_path = BENCH_MAP_BIN;
+        bench("load_level/lvlb_512x512", bench_load_level);
+    }
+
+    // the rest runs on an open map around the player, without the level's own NPCs
+    write_map(BENCH_MAP_TXT, 512, 512, 0);
+    remove(BENCH_MAP_BIN);
+    load_level(BENCH_MAP_TXT);
+    make_points();
+    bench("world_rect_solid", bench_rect_solid);
+    bench("move_and_slide/step_1.5px", bench_move_and_slide);
+    move_step = 40.0f;
+    bench("move_and_slide/step_40px", bench_move_and_slide);
+    bench("add_item_to_inventory", bench_inventory);
+    for (int i = 0; i < MAX_DROPS / 2; ++i) spawn_drop("C01", point_x[i], point_y[i]);
+    bench("drops/spawn_remove", bench_drop_cycle);
+    clear_drops_and_hud();
+
+    static const int npc_counts[] = { 128, 1000, 10000 };
+    char name[64];
+    for (int k = 0; k < 3; ++k) {
+        populate_npcs(npc_counts[k]);
+        snprintf(name, sizeof(name), "update/npcs_%d", npc_counts[k]);
+        bench(name, bench_update);
+    }
+    for (int k = 1; k < 3; ++k) {
+        populate_npcs(npc_counts[k]);
+        snprintf(name, sizeof(name), "snapshot/save_npcs_%d", npc_counts[k]);
+        bench(name, bench_snapshot_save);
+        snprintf(name, sizeof(name), "snapshot/restore_npcs_%d", npc_counts[k]);
+        bench(name, bench_snapshot_restore);
+    }
+    snapshot_free(&bench_snap);
+    populate_npcs(1000);
+    bench("render/software_npcs_1000", bench_render);
+
+    if (write_lights(BENCH_MAP_META, 512, 512) && load_level(BENCH_MAP_TXT)) bench("lighting/dynamic_48", bench_lighting);
+    fprintf(stdout, "\n]}\n");
+
+    remove(BENCH_MAP_TXT);
+    remove(BENCH_MAP_META);
+    destroy_window();
+    SDL_FreeSurface(target);
+    return 0;
+}
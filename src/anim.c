@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "./constants.h"
+#include "./anim.h"
+
+static const char* state_names[ANIM_STATE_COUNT] = { "idle", "walk", "attack", "hit" };
+static const char* dir_names[ANIM_DIRS] = { "down", "up", "left", "right" };
+
+static int name_index(const char* s, const char** names, int n) {
+    for (int i = 0; i < n; ++i) if (strcasecmp(s, names[i]) == 0) return i;
+    return -1;
+}
+
+// cut an image into cols x rows frames appended to the sheet
+static int add_image(AnimSheet* a, const char* path, int cols, int rows, int frame_w, int frame_h) {
+    if (cols < 1 || rows < 1 || a->frame_count + cols * rows > ANIM_MAX_FRAMES) return FALSE;
+    // reloading a sheet finds its images already in the atlas (kept current by atlas_reload_file)
+    Sprite sheet;
+    if (!atlas_find_file(path, cols * frame_w, rows * frame_h, &sheet) && !atlas_add_file(path, cols * frame_w, rows * frame_h, &sheet)) return FALSE;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            Sprite* f = &a->frames[a->frame_count++];
+            f->tex = sheet.tex;
+            f->src = (SDL_Rect){ sheet.src.x + c * frame_w, sheet.src.y + r * frame_h, frame_w, frame_h };
+        }
+    }
+    return TRUE;
+}
+
+// fill the clips the file left out: same state facing down, else idle that way, else idle
+// facing down, else frame 0
+static void resolve_clips(AnimSheet* a) {
+    AnimClip set[ANIM_STATE_COUNT][ANIM_DIRS];
+    memcpy(set, a->clips, sizeof(set));
+    const AnimClip still = { 0, 1, 1.0f, TRUE };
+    for (int s = 0; s < ANIM_STATE_COUNT; ++s) {
+        for (int d = 0; d < ANIM_DIRS; ++d) {
+            if (set[s][d].count > 0) continue;
+            if (set[s][0].count > 0) a->clips[s][d] = set[s][0];
+            else if (set[ANIM_IDLE][d].count > 0) a->clips[s][d] = set[ANIM_IDLE][d];
+            else if (set[ANIM_IDLE][0].count > 0) a->clips[s][d] = set[ANIM_IDLE][0];
+            else a->clips[s][d] = still;
+        }
+    }
+}
+
+void anim_single(AnimSheet* a, Sprite frame) {
+    memset(a, 0, sizeof(*a));
+    a->frames[0] = frame;
+    a->frame_count = 1;
+    resolve_clips(a);
+}
+
+int anim_load(AnimSheet* a, const char* path, int frame_w, int frame_h, Sprite fallback) {
+    anim_single(a, fallback);
+    FILE* f = fopen(path, "r");
+    if (!f) return FALSE;
+    AnimSheet s;
+    memset(&s, 0, sizeof(s));
+    int ok = TRUE, line_no = 0;
+    char line[512];
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_no++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char word[16], arg[256], mode[16];
+        int cols = 1, rows = 1, first, count;
+        float fps;
+        if (sscanf(line, "%15s", word) != 1) continue;
+        if (strcasecmp(word, "image") == 0) {
+            if (sscanf(line, "%*s %255s %d %d", arg, &cols, &rows) < 1) ok = FALSE;
+            else if (!add_image(&s, arg, cols, rows, frame_w, frame_h)) {
+                fprintf(stderr, "%s:%d: could not load sheet image '%s'\n", path, line_no, arg);
+                ok = FALSE;
+            }
+            continue;
+        }
+        int state = name_index(word, state_names, ANIM_STATE_COUNT);
+        int n = sscanf(line, "%*s %15s %d %d %f %15s", arg, &first, &count, &fps, mode);
+        int dir = n < 4 ? -1 : strcasecmp(arg, "all") == 0 ? ANIM_DIRS : name_index(arg, dir_names, ANIM_DIRS);
+        if (state < 0 || dir < 0 || first < 0 || count < 1 || first + count > s.frame_count || fps <= 0.0f) {
+            fprintf(stderr, "%s:%d: bad clip\n", path, line_no);
+            continue;
+        }
+        AnimClip clip = { first, count, 1.0f / fps, !(n == 5 && strcasecmp(mode, "once") == 0) };
+        for (int d = 0; d < ANIM_DIRS; ++d) if (dir == ANIM_DIRS || dir == d) s.clips[state][d] = clip;
+    }
+    fclose(f);
+    if (!ok || s.frame_count == 0) return FALSE;
+    resolve_clips(&s);
+    *a = s;
+    return TRUE;
+}
+
+float anim_length(const AnimSheet* a, AnimState state, int dir) {
+    const AnimClip* c = &a->clips[state][dir];
+    return c->frame_time * (float)c->count;
+}
+
+const Sprite* anim_frame(const AnimSheet* a, AnimState state, int dir, float t) {
+    const AnimClip* c = &a->clips[state][dir];
+    int n = t > 0.0f ? (int)(t / c->frame_time) : 0;
+    if (c->loop) n %= c->count;
+    else if (n >= c->count) n = c->count - 1;
+    return &a->frames[c->first + n];
+}
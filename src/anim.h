@@ -0,0 +1,45 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include "./constants.h"
+#include "./atlas.h"
+
+// Sprite-sheet animations. A sheet is one or more images packed into the atlas, each cut into
+// a grid of equal frames; every frame is a source rect inside the atlas, so switching frames
+// or animations changes no texture. Clips (a run of frames at some rate) are named by state
+// and facing direction and resolved when the sheet loads, so picking a frame at draw time is
+// a table lookup and a division. Frame timing is in simulated seconds.
+//
+// Sheet files (.anim) are text, one directive per line, '#' starts a comment:
+//   image <path> [cols rows]                    frames continue the numbering of earlier images
+//   <state> <dir|all> <first> <count> <fps> [once]
+// states: idle, walk, attack, hit; dirs: down, up, left, right. A looping clip repeats, a
+// `once` clip holds its last frame. Missing clips fall back to the same state facing down,
+// then to idle.
+typedef enum { ANIM_IDLE = 0, ANIM_WALK, ANIM_ATTACK, ANIM_HIT, ANIM_STATE_COUNT } AnimState;
+#define ANIM_DIRS 4 // down, up, left, right (the game's Direction order)
+
+typedef struct {
+    int first, count;  // frames [first, first + count)
+    float frame_time;  // seconds per frame
+    int loop;
+} AnimClip;
+
+typedef struct {
+    Sprite frames[ANIM_MAX_FRAMES];
+    int frame_count;
+    AnimClip clips[ANIM_STATE_COUNT][ANIM_DIRS];
+} AnimSheet;
+
+// load a sheet file; every frame is packed at frame_w x frame_h atlas pixels. FALSE (and a
+// sheet showing only `fallback`) if the file or its images can't be read
+int anim_load(AnimSheet* a, const char* path, int frame_w, int frame_h, Sprite fallback);
+// a sheet with one frame for every clip (entities without a sheet file)
+void anim_single(AnimSheet* a, Sprite frame);
+
+// seconds a clip takes to play through once
+float anim_length(const AnimSheet* a, AnimState state, int dir);
+// frame of the clip t seconds after it started
+const Sprite* anim_frame(const AnimSheet* a, AnimState state, int dir, float t);
+
+#endif
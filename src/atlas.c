@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "./constants.h"
+#include "./atlas.h"
+
+// one atlas page: a static RGBA texture filled by a simple shelf packer
+typedef struct {
+    SDL_Texture* tex;
+    int shelf_x, shelf_y; // next free position on the current shelf
+    int shelf_h;          // height of the current shelf
+} AtlasPage;
+
+static SDL_Renderer* atlas_renderer = NULL;
+static AtlasPage pages[ATLAS_MAX_PAGES];
+static int page_count = 0;
+static Sprite white_sprite;
+// regions filled from image files, so an edited file can be read into them again
+typedef struct { char path[256]; Sprite region; } AtlasFile;
+static AtlasFile* files = NULL;
+static int file_count = 0, file_cap = 0;
+
+static int new_page(void) {
+    if (page_count >= ATLAS_MAX_PAGES) return FALSE;
+    SDL_Texture* t = SDL_CreateTexture(atlas_renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+    if (!t) {
+        fprintf(stderr, "Error creating atlas page: %s\n", SDL_GetError());
+        return FALSE;
+    }
+    SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND);
+    AtlasPage* p = &pages[page_count++];
+    p->tex = t; p->shelf_x = 0; p->shelf_y = 0; p->shelf_h = 0;
+    return TRUE;
+}
+
+// reserve a w x h rect (plus padding) on the first page with room for it
+static int alloc_region(int w, int h, Sprite* out) {
+    int pw = w + ATLAS_PADDING, ph = h + ATLAS_PADDING;
+    if (pw > ATLAS_PAGE_SIZE || ph > ATLAS_PAGE_SIZE) return FALSE;
+    for (int i = 0; ; ++i) {
+        if (i == page_count && !new_page()) return FALSE;
+        AtlasPage* p = &pages[i];
+        int x = p->shelf_x, y = p->shelf_y, sh = p->shelf_h;
+        // start a new shelf when this one is full
+        if (x + pw > ATLAS_PAGE_SIZE) { y += sh; x = 0; sh = 0; }
+        if (y + ph > ATLAS_PAGE_SIZE) continue;
+        p->shelf_x = x + pw; p->shelf_y = y; p->shelf_h = ph > sh ? ph : sh;
+        out->tex = p->tex;
+        out->src = (SDL_Rect){ x, y, w, h };
+        return TRUE;
+    }
+}
+
+// box-filter an RGBA32 surface down (or up) to w x h, weighting color by alpha to avoid dark fringes
+static void resample_rgba(const SDL_Surface* src, Uint8* dst, int w, int h) {
+    const Uint8* sp = (const Uint8*)src->pixels;
+    for (int y = 0; y < h; ++y) {
+        int y0 = y * src->h / h, y1 = (y + 1) * src->h / h; if (y1 <= y0) y1 = y0 + 1;
+        for (int x = 0; x < w; ++x) {
+            int x0 = x * src->w / w, x1 = (x + 1) * src->w / w; if (x1 <= x0) x1 = x0 + 1;
+            unsigned long r = 0, g = 0, b = 0, a = 0, n = 0;
+            for (int sy = y0; sy < y1; ++sy) {
+                const Uint8* row = sp + sy * src->pitch;
+                for (int sx = x0; sx < x1; ++sx) {
+                    const Uint8* px = row + sx * 4;
+                    r += px[0] * px[3]; g += px[1] * px[3]; b += px[2] * px[3]; a += px[3]; n++;
+                }
+            }
+            Uint8* d = dst + (y * w + x) * 4;
+            if (a > 0) { d[0] = (Uint8)(r / a); d[1] = (Uint8)(g / a); d[2] = (Uint8)(b / a); }
+            else { d[0] = d[1] = d[2] = 0; }
+            d[3] = (Uint8)(a / n);
+        }
+    }
+}
+
+int atlas_init(SDL_Renderer* r) {
+    atlas_renderer = r;
+    page_count = 0;
+    if (!new_page()) return FALSE;
+    return atlas_add_color((SDL_Color){255,255,255,255}, 4, 4, &white_sprite);
+}
+
+void atlas_destroy(void) {
+    for (int i = 0; i < page_count; ++i) if (pages[i].tex) SDL_DestroyTexture(pages[i].tex);
+    page_count = 0;
+    white_sprite.tex = NULL;
+    free(files);
+    files = NULL;
+    file_count = file_cap = 0;
+}
+
+SDL_Surface* atlas_prepare_surface(SDL_Surface* surf, int w, int h) {
+    if (!surf || w <= 0 || h <= 0) return NULL;
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGBA32, 0);
+    if (!rgba) return NULL;
+    SDL_Surface* out = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+    if (out) {
+        SDL_LockSurface(rgba);
+        // resample writes tightly packed rows; surfaces created at this size have pitch w * 4
+        if (out->pitch == w * 4) resample_rgba(rgba, (Uint8*)out->pixels, w, h);
+        else { SDL_FreeSurface(out); out = NULL; }
+        SDL_UnlockSurface(rgba);
+    }
+    SDL_FreeSurface(rgba);
+    return out;
+}
+
+int atlas_add_prepared(SDL_Surface* prepared, Sprite* out) {
+    if (!atlas_renderer || !prepared || !alloc_region(prepared->w, prepared->h, out)) return FALSE;
+    SDL_UpdateTexture(out->tex, &out->src, prepared->pixels, prepared->pitch);
+    return TRUE;
+}
+
+int atlas_add_surface(SDL_Surface* surf, int w, int h, Sprite* out) {
+    if (!atlas_renderer) return FALSE;
+    SDL_Surface* prepared = atlas_prepare_surface(surf, w, h);
+    int ok = atlas_add_prepared(prepared, out);
+    SDL_FreeSurface(prepared);
+    return ok;
+}
+
+int atlas_add_file(const char* path, int w, int h, Sprite* out) {
+    SDL_Surface* s = IMG_Load(path);
+    if (!s) return FALSE;
+    int ok = atlas_add_surface(s, w, h, out);
+    SDL_FreeSurface(s);
+    if (ok) atlas_track_file(path, out);
+    return ok;
+}
+
+void atlas_track_file(const char* path, const Sprite* region) {
+    if (file_count == file_cap) {
+        int cap = file_cap ? file_cap * 2 : 64;
+        AtlasFile* p = realloc(files, sizeof(AtlasFile) * (size_t)cap);
+        if (!p) return;
+        files = p; file_cap = cap;
+    }
+    AtlasFile* f = &files[file_count++];
+    snprintf(f->path, sizeof(f->path), "%s", path);
+    f->region = *region;
+}
+
+int atlas_find_file(const char* path, int w, int h, Sprite* out) {
+    for (int i = 0; i < file_count; ++i) {
+        if (files[i].region.src.w != w || files[i].region.src.h != h || strcmp(files[i].path, path) != 0) continue;
+        *out = files[i].region;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+int atlas_reload_file(const char* path) {
+    SDL_Surface* s = NULL;
+    int n = 0;
+    for (int i = 0; i < file_count; ++i) {
+        if (strcmp(files[i].path, path) != 0) continue;
+        if (!s && !(s = IMG_Load(path))) return 0;
+        const Sprite* r = &files[i].region;
+        SDL_Surface* prepared = atlas_prepare_surface(s, r->src.w, r->src.h);
+        if (!prepared) continue;
+        SDL_UpdateTexture(r->tex, &r->src, prepared->pixels, prepared->pitch);
+        SDL_FreeSurface(prepared);
+        n++;
+    }
+    if (s) SDL_FreeSurface(s);
+    return n;
+}
+
+int atlas_add_color(SDL_Color color, int w, int h, Sprite* out) {
+    if (!atlas_renderer || !alloc_region(w, h, out)) return FALSE;
+    Uint8* buf = malloc((size_t)w * h * 4);
+    if (!buf) return FALSE;
+    for (int i = 0; i < w * h; ++i) { buf[i*4] = color.r; buf[i*4+1] = color.g; buf[i*4+2] = color.b; buf[i*4+3] = color.a; }
+    SDL_UpdateTexture(out->tex, &out->src, buf, w * 4);
+    free(buf);
+    return TRUE;
+}
+
+const Sprite* atlas_white(void) { return &white_sprite; }
+
+int atlas_page_count(void) { return page_count; }
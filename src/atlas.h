@@ -0,0 +1,36 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL2/SDL.h>
+
+// a rectangle inside one atlas page; every tile, sprite and UI image is drawn from one of these
+typedef struct {
+    SDL_Texture* tex; // atlas page texture (NULL = nothing loaded, draw nothing)
+    SDL_Rect src;     // pixel rect inside the page
+} Sprite;
+
+int atlas_init(SDL_Renderer* r);
+void atlas_destroy(void);
+// copy a surface into the atlas, box-filtered to w x h pixels
+int atlas_add_surface(SDL_Surface* surf, int w, int h, Sprite* out);
+// CPU half of atlas_add_surface: an RGBA32 copy box-filtered to w x h. Touches no renderer
+// state, so a loader thread can run it; free the result with SDL_FreeSurface
+SDL_Surface* atlas_prepare_surface(SDL_Surface* surf, int w, int h);
+// GPU half: upload a prepared surface into a free atlas region (main thread only)
+int atlas_add_prepared(SDL_Surface* prepared, Sprite* out);
+// load an image file into the atlas at w x h
+int atlas_add_file(const char* path, int w, int h, Sprite* out);
+// remember that a region holds the image at path (atlas_add_file does this itself)
+void atlas_track_file(const char* path, const Sprite* region);
+// a region already holding the image at path at w x h
+int atlas_find_file(const char* path, int w, int h, Sprite* out);
+// read an edited image file again into every region that holds it; returns how many. Regions
+// keep their place, so sprites pointing at them need no update (hot reload)
+int atlas_reload_file(const char* path);
+// solid color block (used for placeholders and fallbacks)
+int atlas_add_color(SDL_Color color, int w, int h, Sprite* out);
+// a solid white region, tinted by vertex color for filled rectangles
+const Sprite* atlas_white(void);
+int atlas_page_count(void);
+
+#endif
@@ -0,0 +1,68 @@
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./batch.h"
+
+static SDL_Renderer* batch_renderer = NULL;
+static SDL_Texture* batch_tex = NULL; // atlas page of the quads currently buffered
+static SDL_Vertex verts[BATCH_MAX_QUADS * 4];
+static int indices[BATCH_MAX_QUADS * 6];
+static int quad_count = 0;
+static int draw_calls = 0;
+static int indices_ready = 0;
+
+void batch_begin(SDL_Renderer* r) {
+    batch_renderer = r;
+    batch_tex = NULL;
+    quad_count = 0;
+    draw_calls = 0;
+    if (!indices_ready) {
+        // two triangles per quad, shared by every flush
+        for (int q = 0; q < BATCH_MAX_QUADS; ++q) {
+            int* ix = &indices[q * 6];
+            ix[0] = q*4; ix[1] = q*4 + 1; ix[2] = q*4 + 2;
+            ix[3] = q*4; ix[4] = q*4 + 2; ix[5] = q*4 + 3;
+        }
+        indices_ready = 1;
+    }
+}
+
+void batch_flush(void) {
+    if (quad_count > 0 && batch_renderer) {
+        SDL_RenderGeometry(batch_renderer, batch_tex, verts, quad_count * 4, indices, quad_count * 6);
+        draw_calls++;
+    }
+    quad_count = 0;
+}
+
+// push a quad with explicit texture coordinates (in atlas pixels)
+static void push_quad(SDL_Texture* tex, float x, float y, float w, float h,
+                      float u0, float v0, float u1, float v1, SDL_Color c) {
+    if (tex != batch_tex || quad_count >= BATCH_MAX_QUADS) {
+        batch_flush();
+        batch_tex = tex;
+    }
+    const float inv = 1.0f / ATLAS_PAGE_SIZE;
+    u0 *= inv; v0 *= inv; u1 *= inv; v1 *= inv;
+    SDL_Vertex* v = &verts[quad_count * 4];
+    v[0] = (SDL_Vertex){ { x,     y     }, c, { u0, v0 } };
+    v[1] = (SDL_Vertex){ { x + w, y     }, c, { u1, v0 } };
+    v[2] = (SDL_Vertex){ { x + w, y + h }, c, { u1, v1 } };
+    v[3] = (SDL_Vertex){ { x,     y + h }, c, { u0, v1 } };
+    quad_count++;
+}
+
+void batch_sprite(const Sprite* s, float x, float y, float w, float h, SDL_Color tint) {
+    if (!s || !s->tex) return;
+    push_quad(s->tex, x, y, w, h, (float)s->src.x, (float)s->src.y,
+              (float)(s->src.x + s->src.w), (float)(s->src.y + s->src.h), tint);
+}
+
+void batch_rect(float x, float y, float w, float h, SDL_Color color) {
+    const Sprite* white = atlas_white();
+    if (!white->tex) return;
+    // sample the middle of the white block so filtering never reaches its edges
+    float cx = white->src.x + white->src.w / 2.0f, cy = white->src.y + white->src.h / 2.0f;
+    push_quad(white->tex, x, y, w, h, cx, cy, cx, cy, color);
+}
+
+int batch_draw_calls(void) { return draw_calls; }
@@ -0,0 +1,17 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <SDL2/SDL.h>
+#include "./atlas.h"
+
+// sprite batcher: quads are buffered and submitted with one SDL_RenderGeometry call
+// per run of the same atlas page. Anything drawn with plain SDL_Render* calls must
+// batch_flush() first so draw order is preserved.
+void batch_begin(SDL_Renderer* r);
+void batch_sprite(const Sprite* s, float x, float y, float w, float h, SDL_Color tint);
+void batch_rect(float x, float y, float w, float h, SDL_Color color);
+void batch_flush(void);
+// number of SDL_RenderGeometry submissions since batch_begin()
+int batch_draw_calls(void);
+
+#endif
@@ -0,0 +1,38 @@
+#include <math.h>
+#include "./constants.h"
+#include "./camera.h"
+
+// top-left of the view along one axis: center a map that fits, otherwise follow the focus
+// and stop at the map edges
+static float follow_axis(float map_px, float view_px, float focus) {
+    if (map_px <= view_px) return -(view_px - map_px) / 2.0f;
+    float pos = focus - view_px / 2.0f;
+    if (pos < 0.0f) pos = 0.0f;
+    if (pos > map_px - view_px) pos = map_px - view_px;
+    return pos;
+}
+
+void camera_follow(Camera* cam, float focus_x, float focus_y, float map_w, float map_h, int window_w, int window_h, float scale) {
+    cam->scale = scale > 0.0f ? scale : 1.0f;
+    cam->view_w = window_w / cam->scale;
+    cam->view_h = window_h / cam->scale;
+    // snap to whole screen pixels so tiles don't shimmer while the camera moves
+    cam->x = floorf(follow_axis(map_w, cam->view_w, focus_x) * cam->scale) / cam->scale;
+    cam->y = floorf(follow_axis(map_h, cam->view_h, focus_y) * cam->scale) / cam->scale;
+}
+
+int camera_visible_tiles(const Camera* cam, int tile_size, int rows, int cols, int* r0, int* c0, int* r1, int* c1) {
+    *c0 = (int)floorf(cam->x / tile_size);
+    *r0 = (int)floorf(cam->y / tile_size);
+    *c1 = (int)floorf((cam->x + cam->view_w) / tile_size);
+    *r1 = (int)floorf((cam->y + cam->view_h) / tile_size);
+    if (*c0 < 0) *c0 = 0;
+    if (*r0 < 0) *r0 = 0;
+    if (*c1 > cols - 1) *c1 = cols - 1;
+    if (*r1 > rows - 1) *r1 = rows - 1;
+    return *r0 <= *r1 && *c0 <= *c1;
+}
+
+int camera_sees(const Camera* cam, float x, float y, float w, float h) {
+    return x < cam->x + cam->view_w && y < cam->y + cam->view_h && x + w > cam->x && y + h > cam->y;
+}
@@ -0,0 +1,23 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+// 2D camera: which part of the world is on screen and at what zoom. The view follows a focus
+// point (the player) and stops at the level edges; a level smaller than the view is centered.
+// Everything drawn in world space goes through camera_screen_x/y and is scaled by `scale`.
+typedef struct {
+    float x, y;           // world pixel at the top-left corner of the window
+    float scale;          // screen pixels per world pixel (zoom)
+    float view_w, view_h; // window size in world pixels
+} Camera;
+
+// frame the view for a window_w x window_h window over a map_w x map_h pixel level
+void camera_follow(Camera* cam, float focus_x, float focus_y, float map_w, float map_h, int window_w, int window_h, float scale);
+// tiles overlapping the view, [r0, r1] x [c0, c1] clamped to a rows x cols map; FALSE if none
+int camera_visible_tiles(const Camera* cam, int tile_size, int rows, int cols, int* r0, int* c0, int* r1, int* c1);
+// whether the world rectangle (x, y, w, h) overlaps the view
+int camera_sees(const Camera* cam, float x, float y, float w, float h);
+
+static inline float camera_screen_x(const Camera* cam, float wx) { return (wx - cam->x) * cam->scale; }
+static inline float camera_screen_y(const Camera* cam, float wy) { return (wy - cam->y) * cam->scale; }
+
+#endif
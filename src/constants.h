@@ -1,25 +1,64 @@
 #define FALSE 0
 #define TRUE 1
 
-#define MAX_ROWS 128
-#define MAX_COLS 128
 #define TOKEN_SIZE 4 // (up to 3 chars)
 #define TILE_SIZE 32
-#define MAX_TEXTURE_CACHE 256
+#define MAX_TOKENS 256 // distinct level/item tokens (tile ids are uint16_t)
 
 #define WINDOW_WIDTH 1600
 #define WINDOW_HEIGHT 1000
 
-#define FPS 30
-#define FRAME_TARGET_TIME (1000 / FPS)
+#define PACING_DEFAULT_FPS 60 // frame rate when the display's refresh rate is unknown (--fps overrides)
+#define PACING_SPIN_MS 2.0 // the last part of a frame wait spins instead of sleeping
+#define PACING_LATCH_MARGIN_MS 1.0 // late-latch slack between the estimated frame work and the refresh
+#define PACING_LATCH_FRAMES 30 // late-latch estimates a frame's work as the slowest of this many
+#define PACING_HISTORY 120 // frame intervals kept for the jitter stats
+
+#define SIM_TICK_RATE 60 // default simulation ticks per second (--tick-rate)
+#define MAX_SIM_STEPS_PER_FRAME 5 // catch-up cap so a long stall doesn't spiral
+#define HEADLESS_DEFAULT_TICKS 100000 // ticks simulated by --headless when no count is given
+#define INPUT_QUEUE_MAX 64 // key actions waiting for the next simulation tick
+#define REWIND_TICKS 300 // per-tick snapshots kept for rewinding (5 s at the default tick rate)
+#define QUICKSAVE_PATH "quicksave.snap" // F5 writes the game state here, F9 loads it
 
 #define CARD_SLOTS 5
 #define OTHER_SLOTS 10
 
 #define PLAYER_BASE_DAMAGE 4
 #define NPC_BASE_DAMAGE 5
+#define NPC_ATTACK_COOLDOWN 1.0f // seconds between an NPC's melee hits
+#define NPC_HIT_FLASH 0.25f // seconds a hostile NPC flashes (and plays its hit clip) when struck
+#define NPC_NEUTRAL_HIT_FLASH 0.12f // same for a neutral NPC, which takes no damage
 #define PICKUP_RANGE 24
 
-#define MAX_NPCS 128
+#define MAX_NPCS 128 // initial NPC capacity; storage grows on demand
+#define NPC_MAX_LIMIT (1 << 20) // default --max-npcs (handle index bits cap it anyway)
 #define MAX_DROPS 64
 #define HUD_MSG_MAX 8
+#define DMG_POPUP_MAX 16
+
+#define ATLAS_PAGE_SIZE 1024 // atlas pages are square textures of this size
+#define ATLAS_MAX_PAGES 8
+#define ATLAS_PADDING 2 // empty pixels between packed regions (avoids filtering bleed)
+#define ATLAS_SPRITE_SCALE 2 // sprites are packed at this multiple of their on-screen size
+#define ANIM_MAX_FRAMES 32 // frames in one animation sheet (all its images together)
+#define BATCH_MAX_QUADS 4096 // quads buffered before a forced SDL_RenderGeometry flush
+#define WORLD_CHUNK_TILES 32 // world chunk edge in tiles (a chunk's collision row is one uint32_t)
+#define WORLD_RESIDENCY_RADIUS 2 // chunks kept loaded on each side of the player's chunk (--residency)
+#define LOADER_UPLOADS_PER_FRAME 4 // prepared images the main thread uploads to the atlas per frame during a level load
+#define WATCH_MAX_DIRS 8 // directories the hot reloader watches
+#define WATCH_POLL_MS 250 // rescan interval where file change notifications are not available
+#define PROFILER_HISTORY 240 // frames kept by the profiler ring buffer (graph width in pixels)
+#define PROFILER_MAX_EVENTS 64 // timed scopes stored per frame for the trace export
+#define PROFILER_MAX_DEPTH 8 // deepest nesting of profiler scopes
+#define JOBS_MAX_WORKERS 16 // job system threads, including the main thread (--threads)
+#define NPC_JOB_GRAIN 256 // NPCs per job chunk in the parallel AI update
+#define FLOW_MAX_DIST 24 // flow field search depth in tiles (well past the 200px chase radius)
+#define CAMERA_MIN_SCALE 0.5f // zoom limits for the -/= keys (render_scale)
+#define CAMERA_MAX_SCALE 3.0f
+#define CAMERA_ZOOM_STEP 0.25f
+#define LIGHT_AMBIENT 40 // light level (0-255) of unlit tiles in levels that have lights
+#define LIGHT_TORCH_RADIUS 192 // player torch radius in pixels
+#define LIGHT_CARD_RADIUS 64 // glow radius of card drops in pixels
+#define TEXT_CACHE_SLOTS 128 // laid-out strings kept by the text cache
+#define TEXT_MAX_LEN 128 // longest string the text cache lays out
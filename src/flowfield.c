@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "./constants.h"
+#include "./world.h"
+#include "./flowfield.h"
+
+void flow_free(FlowField* f) {
+    free(f->dist); free(f->queue);
+    memset(f, 0, sizeof(*f));
+    f->target_r = f->target_c = -1;
+}
+
+int flow_reset(FlowField* f, int r0, int c0, int rows, int cols) {
+    int cells = rows * cols;
+    if (cells > f->capacity) {
+        uint16_t* d = realloc(f->dist, sizeof(uint16_t) * (size_t)cells);
+        if (d) f->dist = d;
+        int* q = realloc(f->queue, sizeof(int) * (size_t)cells);
+        if (q) f->queue = q;
+        if (!d || !q) return FALSE;
+        f->capacity = cells;
+    }
+    f->r0 = r0; f->c0 = c0; f->rows = rows; f->cols = cols;
+    for (int i = 0; i < cells; ++i) f->dist[i] = FLOW_UNREACHED;
+    f->visited = 0;
+    f->target_r = f->target_c = -1;
+    return TRUE;
+}
+
+int flow_update(FlowField* f, int target_r, int target_c, int max_dist) {
+    if (target_r == f->target_r && target_c == f->target_c && max_dist == f->max_dist) return FALSE;
+    // only the cells the last search reached need clearing
+    for (int k = 0; k < f->visited; ++k) f->dist[f->queue[k]] = FLOW_UNREACHED;
+    f->visited = 0;
+    f->target_r = target_r; f->target_c = target_c; f->max_dist = max_dist;
+    int tr = target_r - f->r0, tc = target_c - f->c0;
+    if (tr < 0 || tc < 0 || tr >= f->rows || tc >= f->cols) return TRUE;
+
+    static const int dr[4] = { -1, 1, 0, 0 }, dc[4] = { 0, 0, -1, 1 };
+    int head = 0, tail = 0;
+    f->dist[tr * f->cols + tc] = 0;
+    f->queue[tail++] = tr * f->cols + tc;
+    while (head < tail) {
+        int cell = f->queue[head++];
+        int d = f->dist[cell];
+        if (d >= max_dist) continue;
+        int r = cell / f->cols, c = cell % f->cols;
+        for (int k = 0; k < 4; ++k) {
+            int nr = r + dr[k], nc = c + dc[k];
+            if (nr < 0 || nc < 0 || nr >= f->rows || nc >= f->cols) continue;
+            int n = nr * f->cols + nc;
+            if (f->dist[n] != FLOW_UNREACHED || world_solid(f->r0 + nr, f->c0 + nc)) continue;
+            f->dist[n] = (uint16_t)(d + 1);
+            f->queue[tail++] = n;
+        }
+    }
+    f->visited = tail;
+    return TRUE;
+}
+
+int flow_direction(const FlowField* f, float x, float y, float* dx, float* dy) {
+    int r = (int)(y / TILE_SIZE) - f->r0, c = (int)(x / TILE_SIZE) - f->c0;
+    if (x < 0 || y < 0 || r < 0 || c < 0 || r >= f->rows || c >= f->cols) return FALSE;
+    int best = f->dist[r * f->cols + c];
+    if (best == FLOW_UNREACHED || best == 0) return FALSE;
+    // 8 neighbors; a diagonal only counts when both orthogonal cells are open, so chasers
+    // don't try to cut wall corners
+    static const int dr[8] = { -1, 1, 0, 0, -1, -1, 1, 1 }, dc[8] = { 0, 0, -1, 1, -1, 1, -1, 1 };
+    int best_k = -1;
+    for (int k = 0; k < 8; ++k) {
+        int nr = r + dr[k], nc = c + dc[k];
+        if (nr < 0 || nc < 0 || nr >= f->rows || nc >= f->cols) continue;
+        int d = f->dist[nr * f->cols + nc];
+        if (d == FLOW_UNREACHED) continue;
+        if (k >= 4 && (f->dist[r * f->cols + nc] == FLOW_UNREACHED || f->dist[nr * f->cols + c] == FLOW_UNREACHED)) continue;
+        if (d < best) { best = d; best_k = k; }
+    }
+    if (best_k < 0) return FALSE;
+    float tx = (f->c0 + c + dc[best_k] + 0.5f) * TILE_SIZE, ty = (f->r0 + r + dr[best_k] + 0.5f) * TILE_SIZE;
+    float vx = tx - x, vy = ty - y;
+    float len = sqrtf(vx * vx + vy * vy);
+    if (len < 0.001f) return FALSE;
+    *dx = vx / len; *dy = vy / len;
+    return TRUE;
+}
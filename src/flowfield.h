@@ -0,0 +1,32 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <stdint.h>
+
+#define FLOW_UNREACHED 0xFFFFu
+
+// BFS distance field toward one target tile, over a window of the world (the resident
+// chunks). Every chaser reads its steering direction from the same field, so pathing costs one
+// grid pass per player tile change instead of a search per NPC. The BFS stops at max_dist
+// steps, which is all the chase radius needs.
+typedef struct {
+    int r0, c0;        // window origin in tiles
+    int rows, cols;    // window size in tiles
+    int capacity;      // cells allocated
+    int target_r, target_c; // tile the field leads to, -1 = none computed
+    int max_dist;
+    uint16_t* dist;    // steps to the target, FLOW_UNREACHED if not reached
+    int* queue;        // BFS order; the first `visited` entries are the cells the field reached
+    int visited;
+} FlowField;
+
+void flow_free(FlowField* f);
+// cover rows x cols tiles from (r0, c0); drops the current field
+int flow_reset(FlowField* f, int r0, int c0, int rows, int cols);
+// recompute toward (target_r, target_c) if the target moved; returns TRUE if it recomputed
+int flow_update(FlowField* f, int target_r, int target_c, int max_dist);
+// unit direction to steer from pixel position (x, y): toward the center of the neighboring
+// tile closest to the target. FALSE when (x, y) is unreached or already on the target tile.
+int flow_direction(const FlowField* f, float x, float y, float* dx, float* dy);
+
+#endif
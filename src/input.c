@@ -0,0 +1,90 @@
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./input.h"
+
+static InputAction queue[INPUT_QUEUE_MAX]; // ring buffer
+static int queue_head = 0, queue_count = 0;
+static int held[4]; // keys held per direction (arrows and WASD both count)
+
+static int dir_index(uint8_t dir) { return dir == INPUT_LEFT ? 0 : dir == INPUT_RIGHT ? 1 : dir == INPUT_UP ? 2 : 3; }
+
+// key down/up actions change the held keys; presses only mean something to input_tick
+static void apply_held(const InputAction* a) {
+    if (a->type == ACTION_MOVE_START) held[dir_index(a->dir)]++;
+    else if (a->type == ACTION_MOVE_STOP) { if (held[dir_index(a->dir)] > 0) held[dir_index(a->dir)]--; }
+    else if (a->type == ACTION_RELEASE_ALL) memset(held, 0, sizeof(held));
+}
+
+static void push(uint8_t type, uint8_t dir, uint32_t time) {
+    // a full queue means nobody has ticked for a long time: make room by applying the oldest
+    // action at once. A press in it is lost, but a key up never is, so no direction sticks
+    if (queue_count >= INPUT_QUEUE_MAX) {
+        apply_held(&queue[queue_head]);
+        queue_head = (queue_head + 1) % INPUT_QUEUE_MAX;
+        queue_count--;
+    }
+    InputAction* a = &queue[(queue_head + queue_count++) % INPUT_QUEUE_MAX];
+    a->type = type; a->dir = dir; a->time = time;
+}
+
+void input_clear(void) {
+    queue_head = queue_count = 0;
+    memset(held, 0, sizeof(held));
+}
+
+static uint8_t key_dir(SDL_Keycode key) {
+    switch (key) {
+        case SDLK_LEFT: case SDLK_a: return INPUT_LEFT;
+        case SDLK_RIGHT: case SDLK_d: return INPUT_RIGHT;
+        case SDLK_UP: case SDLK_w: return INPUT_UP;
+        case SDLK_DOWN: case SDLK_s: return INPUT_DOWN;
+        default: return 0;
+    }
+}
+
+int input_handle_event(const SDL_Event* event) {
+    if (event->type == SDL_WINDOWEVENT && event->window.event == SDL_WINDOWEVENT_FOCUS_LOST) {
+        // keys released while the window is not focused never send a key up
+        push(ACTION_RELEASE_ALL, 0, event->window.timestamp);
+        return TRUE;
+    }
+    if (event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) return FALSE;
+    SDL_Keycode key = event->key.keysym.sym;
+    uint32_t time = event->key.timestamp;
+    uint8_t dir = key_dir(key);
+    if (dir) {
+        if (!event->key.repeat) push(event->type == SDL_KEYDOWN ? ACTION_MOVE_START : ACTION_MOVE_STOP, dir, time);
+        return TRUE;
+    }
+    if (event->type != SDL_KEYDOWN) return key == SDLK_SPACE || key == SDLK_e || key == SDLK_RETURN;
+    if (event->key.repeat) return key == SDLK_SPACE || key == SDLK_e || key == SDLK_RETURN;
+    if (key == SDLK_SPACE) push(ACTION_ATTACK, 0, time);
+    else if (key == SDLK_e) push(ACTION_INTERACT, 0, time);
+    else if (key == SDLK_RETURN) push(ACTION_CONFIRM, 0, time);
+    else return FALSE;
+    return TRUE;
+}
+
+uint8_t input_tick(uint32_t time) {
+    uint8_t pressed = 0;
+    while (queue_count > 0) {
+        const InputAction* a = &queue[queue_head];
+        // SDL_TICKS_PASSED copes with the millisecond counter wrapping
+        if (!SDL_TICKS_PASSED(time, a->time)) break;
+        uint8_t bit = a->type == ACTION_ATTACK ? INPUT_ATTACK : a->type == ACTION_INTERACT ? INPUT_TALK : a->type == ACTION_CONFIRM ? INPUT_CONFIRM : 0;
+        // a second press of the same action goes to the next tick (so does everything after it)
+        if (bit & pressed) break;
+        pressed |= bit;
+        if (a->type == ACTION_MOVE_START) pressed |= a->dir; // a tap shorter than a tick still moves for that tick
+        apply_held(a);
+        queue_head = (queue_head + 1) % INPUT_QUEUE_MAX;
+        queue_count--;
+    }
+    uint8_t input = pressed;
+    if (held[0]) input |= INPUT_LEFT;
+    if (held[1]) input |= INPUT_RIGHT;
+    if (held[2]) input |= INPUT_UP;
+    if (held[3]) input |= INPUT_DOWN;
+    return input;
+}
@@ -0,0 +1,31 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+// what the simulation sees of the player's input for one tick. The movement bits are held
+// directions; the others mean "pressed during this tick" (one action each)
+enum { INPUT_LEFT = 1, INPUT_RIGHT = 2, INPUT_UP = 4, INPUT_DOWN = 8, INPUT_ATTACK = 16, INPUT_TALK = 32, INPUT_CONFIRM = 64 };
+#define INPUT_MOVE_MASK (INPUT_LEFT | INPUT_RIGHT | INPUT_UP | INPUT_DOWN)
+
+// Key events are turned into actions in the order they happened, stamped with the SDL event
+// time, and queued. Each simulation tick takes the actions up to the tick's end time, so a
+// press is never lost between two keyboard polls and waits at most one tick.
+typedef enum { ACTION_ATTACK, ACTION_INTERACT, ACTION_CONFIRM, ACTION_MOVE_START, ACTION_MOVE_STOP, ACTION_RELEASE_ALL } ActionType;
+
+typedef struct {
+    uint8_t type; // ActionType
+    uint8_t dir;  // INPUT_LEFT.. for ACTION_MOVE_START/STOP
+    uint32_t time; // SDL event timestamp (ms)
+} InputAction;
+
+// drop queued actions and held keys
+void input_clear(void);
+// queue the actions of a game key event; FALSE if the event isn't one
+int input_handle_event(const SDL_Event* event);
+// INPUT_* bits for the tick ending at `time` (ms): directions held at the end of it or
+// pressed during it, and at most one of each press; later actions stay queued
+uint8_t input_tick(uint32_t time);
+
+#endif
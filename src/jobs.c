@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./jobs.h"
+
+// a worker's run of chunk indices [head, tail): the owner pops at tail, thieves take at head
+typedef struct {
+    SDL_mutex* lock;
+    int head, tail;
+} JobDeque;
+
+static JobDeque deques[JOBS_MAX_WORKERS];
+static SDL_Thread* threads[JOBS_MAX_WORKERS];
+static int worker_count = 1;
+static SDL_sem* start_sem = NULL; // posted once per worker thread per batch
+static SDL_sem* done_sem = NULL;  // posted by each worker thread when it leaves a batch
+static SDL_atomic_t quit;
+
+// the batch being run
+static JobRangeFn batch_fn;
+static void* batch_ctx;
+static int batch_count, batch_grain;
+
+static int pop_own(int w) {
+    JobDeque* d = &deques[w];
+    SDL_LockMutex(d->lock);
+    int chunk = d->head < d->tail ? --d->tail : -1;
+    SDL_UnlockMutex(d->lock);
+    return chunk;
+}
+
+static int steal(int w) {
+    for (int k = 1; k < worker_count; ++k) {
+        JobDeque* d = &deques[(w + k) % worker_count];
+        SDL_LockMutex(d->lock);
+        int chunk = d->head < d->tail ? d->head++ : -1;
+        SDL_UnlockMutex(d->lock);
+        if (chunk >= 0) return chunk;
+    }
+    return -1;
+}
+
+// run chunks until none are left anywhere
+static void work(int w) {
+    for (;;) {
+        int chunk = pop_own(w);
+        if (chunk < 0) chunk = steal(w);
+        if (chunk < 0) return;
+        int begin = chunk * batch_grain;
+        int end = begin + batch_grain < batch_count ? begin + batch_grain : batch_count;
+        batch_fn(begin, end, w, batch_ctx);
+    }
+}
+
+static int worker_main(void* data) {
+    int w = (int)(intptr_t)data;
+    for (;;) {
+        SDL_SemWait(start_sem);
+        if (SDL_AtomicGet(&quit)) return 0;
+        work(w);
+        SDL_SemPost(done_sem);
+    }
+}
+
+int jobs_init(int n) {
+    jobs_shutdown();
+    if (n <= 0) n = SDL_GetCPUCount();
+    if (n > JOBS_MAX_WORKERS) n = JOBS_MAX_WORKERS;
+    if (n < 1) n = 1;
+    for (int w = 0; w < n; ++w) {
+        deques[w].lock = SDL_CreateMutex();
+        if (!deques[w].lock) { n = w; break; }
+    }
+    worker_count = n > 0 ? n : 1;
+    if (worker_count == 1) return TRUE;
+    start_sem = SDL_CreateSemaphore(0);
+    done_sem = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&quit, 0);
+    for (int w = 1; w < worker_count; ++w) {
+        threads[w] = start_sem && done_sem ? SDL_CreateThread(worker_main, "job-worker", (void*)(intptr_t)w) : NULL;
+        if (!threads[w]) {
+            fprintf(stderr, "Could not start job worker thread: %s\n", SDL_GetError());
+            // keep the workers that did start
+            worker_count = w;
+            break;
+        }
+    }
+    return TRUE;
+}
+
+void jobs_shutdown(void) {
+    SDL_AtomicSet(&quit, 1);
+    for (int w = 1; w < worker_count; ++w) if (threads[w]) SDL_SemPost(start_sem);
+    for (int w = 1; w < worker_count; ++w) {
+        if (threads[w]) SDL_WaitThread(threads[w], NULL);
+        threads[w] = NULL;
+    }
+    for (int w = 0; w < JOBS_MAX_WORKERS; ++w) {
+        if (deques[w].lock) SDL_DestroyMutex(deques[w].lock);
+        deques[w].lock = NULL;
+    }
+    if (start_sem) SDL_DestroySemaphore(start_sem);
+    if (done_sem) SDL_DestroySemaphore(done_sem);
+    start_sem = done_sem = NULL;
+    worker_count = 1;
+}
+
+int jobs_worker_count(void) { return worker_count; }
+
+void jobs_parallel_for(int count, int grain, JobRangeFn fn, void* ctx) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    // small batches are not worth waking anyone for
+    if (worker_count == 1 || count <= grain) { fn(0, count, 0, ctx); return; }
+    batch_fn = fn; batch_ctx = ctx; batch_count = count; batch_grain = grain;
+    int chunks = (count + grain - 1) / grain;
+    int used = chunks < worker_count ? chunks : worker_count;
+    for (int w = 0; w < worker_count; ++w) {
+        SDL_LockMutex(deques[w].lock);
+        deques[w].head = w < used ? chunks * w / used : 0;
+        deques[w].tail = w < used ? chunks * (w + 1) / used : 0;
+        SDL_UnlockMutex(deques[w].lock);
+    }
+    for (int w = 1; w < used; ++w) SDL_SemPost(start_sem);
+    work(0);
+    // every woken worker has left the batch before the next one can reuse the deques
+    for (int w = 1; w < used; ++w) SDL_SemWait(done_sem);
+}
@@ -0,0 +1,19 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+// small work-stealing job system for data-parallel loops. jobs_parallel_for cuts [0, count)
+// into chunks of `grain` items and gives each worker (the calling thread is worker 0) a
+// contiguous run of them. A worker takes chunks from the back of its own run and, once that
+// is empty, steals from the front of the others'. Which worker runs a chunk varies from call
+// to call, so anything order-dependent must be recorded per worker and merged afterwards.
+typedef void (*JobRangeFn)(int begin, int end, int worker, void* ctx);
+
+// start threads - 1 worker threads (threads <= 0: one per CPU); everything runs inline with 1
+int jobs_init(int threads);
+void jobs_shutdown(void);
+// workers including the calling thread; worker ids passed to JobRangeFn are below this
+int jobs_worker_count(void);
+// run fn over [0, count) and return once every chunk has finished
+void jobs_parallel_for(int count, int grain, JobRangeFn fn, void* ctx);
+
+#endif
@@ -0,0 +1,501 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "./constants.h"
+#include "./level.h"
+
+int level_token_is_solid(const char* token) {
+    return strcmp(token, "01") == 0 || strcmp(token, "02") == 0 || strcmp(token, "04") == 0;
+}
+
+// growable buffers the text parser fills before they are handed to a LevelData
+typedef struct {
+    char (*tokens)[TOKEN_SIZE]; int token_count, token_cap;
+    uint16_t* cells; int cell_count, cell_cap; // every row's cells back to back
+    int* row_start; int* row_len; int rows, row_cap;
+    LevelNpcSpawn* npcs; int npc_count, npc_cap;
+    char* strings; int strings_size, strings_cap;
+    LevelLight* lights; int light_count, light_cap;
+    int player_row, player_col;
+} LevelBuilder;
+
+static int grow(void** p, int* cap, int need, size_t elem) {
+    if (need <= *cap) return TRUE;
+    int n = *cap ? *cap * 2 : 64;
+    while (n < need) n *= 2;
+    void* q = realloc(*p, elem * (size_t)n);
+    if (!q) return FALSE;
+    *p = q; *cap = n;
+    return TRUE;
+}
+
+static int grow_rows(LevelBuilder* b) {
+    if (b->rows < b->row_cap) return TRUE;
+    int cap = b->row_cap ? b->row_cap * 2 : 64;
+    int* start = realloc(b->row_start, sizeof(int) * (size_t)cap);
+    if (!start) return FALSE;
+    b->row_start = start;
+    int* len = realloc(b->row_len, sizeof(int) * (size_t)cap);
+    if (!len) return FALSE;
+    b->row_len = len;
+    b->row_cap = cap;
+    return TRUE;
+}
+
+static uint16_t builder_token(LevelBuilder* b, const char* token) {
+    if (!token[0]) return 0;
+    for (int i = 1; i < b->token_count; ++i) if (strcmp(b->tokens[i], token) == 0) return (uint16_t)i;
+    if (b->token_count >= 0xFFFF || !grow((void**)&b->tokens, &b->token_cap, b->token_count + 1, TOKEN_SIZE)) return 0;
+    strncpy(b->tokens[b->token_count], token, TOKEN_SIZE - 1);
+    b->tokens[b->token_count][TOKEN_SIZE - 1] = '\0';
+    return (uint16_t)b->token_count++;
+}
+
+static uint32_t builder_string(LevelBuilder* b, const char* s) {
+    if (!s[0]) return 0;
+    int len = (int)strlen(s) + 1;
+    if (!grow((void**)&b->strings, &b->strings_cap, b->strings_size + len, 1)) return 0;
+    memcpy(b->strings + b->strings_size, s, (size_t)len);
+    uint32_t off = (uint32_t)b->strings_size;
+    b->strings_size += len;
+    return off;
+}
+
+static void builder_free(LevelBuilder* b) {
+    free(b->tokens); free(b->cells); free(b->row_start); free(b->row_len); free(b->npcs); free(b->strings); free(b->lights);
+    memset(b, 0, sizeof(*b));
+}
+
+// apply an options string (comma-separated: hostile, neutral, hp=, drop=, lvl=, say=) to a spawn
+static void apply_options(LevelBuilder* b, LevelNpcSpawn* n, const char* opts_str) {
+    if (!opts_str || !opts_str[0]) return;
+    char low[128]; size_t li = 0; for (const char *pp = opts_str; *pp && li < sizeof(low)-1; ++pp) low[li++] = (char)tolower((unsigned char)*pp); low[li]='\0';
+    int looks_like_opts = 0;
+    if (strstr(low, "hostile") || strstr(low, "say=") || strchr(opts_str, ',') || strchr(opts_str, '=')) looks_like_opts = 1;
+    if (!looks_like_opts) return;
+    char opts[256]; strncpy(opts, opts_str, sizeof(opts)-1); opts[sizeof(opts)-1] = '\0';
+    char *tok2 = strtok(opts, ",");
+    while (tok2) {
+        // trim
+        size_t p = strlen(tok2); while (p>0 && (unsigned char)tok2[p-1]<32) tok2[--p]='\0';
+        while (*tok2 && (unsigned char)*tok2<33) tok2++;
+        char lowtok[128]; size_t lli=0; for (const char *pp = tok2; *pp && lli < sizeof(lowtok)-1; ++pp) lowtok[lli++] = (char)tolower((unsigned char)*pp); lowtok[lli]='\0';
+        if (strstr(lowtok, "hostile") != NULL) { n->hostile = 1; }
+        else if (strstr(lowtok, "neutral") != NULL || strstr(lowtok, "friendly") != NULL) { n->hostile = 0; }
+        else if (strncasecmp(tok2, "hp=", 3) == 0) { n->hp = n->max_hp = atoi(tok2+3); }
+        else if (strncasecmp(tok2, "drop=", 5) == 0) { strncpy(n->drop_id, tok2+5, sizeof(n->drop_id)-1); n->drop_id[sizeof(n->drop_id)-1]='\0'; }
+        else if (strncasecmp(tok2, "lvl=", 4) == 0) { n->level_on_kill = atoi(tok2+4); }
+        else if (strncasecmp(tok2, "say=", 4) == 0) {
+            char *s = tok2+4;
+            if (*s == '"') { s++; size_t sl = strlen(s); if (sl>0 && s[sl-1]=='"') s[sl-1]='\0'; }
+            char dialog[128]; strncpy(dialog, s, sizeof(dialog)-1); dialog[sizeof(dialog)-1] = '\0';
+            n->dialog = builder_string(b, dialog);
+        }
+        tok2 = strtok(NULL, ",");
+    }
+}
+
+// a meta line "row,col: light, radius=N, color=RRGGBB" adds a static light at that tile
+static void add_light(LevelBuilder* b, int row, int col, const char* opts_str) {
+    if (!grow((void**)&b->lights, &b->light_cap, b->light_count + 1, sizeof(LevelLight))) return;
+    LevelLight* l = &b->lights[b->light_count++];
+    memset(l, 0, sizeof(*l));
+    l->row = row; l->col = col;
+    l->radius = 5;
+    l->r = l->g = l->b = 255;
+    char opts[256]; strncpy(opts, opts_str, sizeof(opts)-1); opts[sizeof(opts)-1] = '\0';
+    for (char *tok = strtok(opts, ","); tok; tok = strtok(NULL, ",")) {
+        while (*tok && (unsigned char)*tok < 33) tok++;
+        if (strncasecmp(tok, "radius=", 7) == 0) { l->radius = atoi(tok+7); if (l->radius < 1) l->radius = 1; }
+        else if (strncasecmp(tok, "color=", 6) == 0) {
+            unsigned long rgb = strtoul(tok+6 + (tok[6] == '#'), NULL, 16);
+            l->r = (uint8_t)(rgb >> 16); l->g = (uint8_t)(rgb >> 8); l->b = (uint8_t)rgb;
+        }
+    }
+}
+
+// read one line of any length; returns NULL at end of file
+static char* read_line(FILE* f, char** buf, int* cap) {
+    int len = 0;
+    for (;;) {
+        if (!grow((void**)buf, cap, len + 256, 1)) return NULL;
+        if (!fgets(*buf + len, *cap - len, f)) return len > 0 ? *buf : NULL;
+        len += (int)strlen(*buf + len);
+        if (len > 0 && (*buf)[len-1] == '\n') { (*buf)[len-1] = '\0'; return *buf; }
+    }
+}
+
+// parse one cell token (e.g. "01", "A(00)", "P(00)", "A(hostile,hp=5)") at row r, col c
+static int parse_cell(LevelBuilder* b, const char* token, int r, int c) {
+    // support syntax like A(00) or P(00): core token before '(' and underlying tile inside
+    char core[64];
+    char under[TOKEN_SIZE] = "";
+    char opts_str[128] = ""; // full options string when present
+    strncpy(core, token, sizeof(core)-1);
+    core[sizeof(core)-1] = '\0';
+    char *lp = strchr(core, '(');
+    if (lp) {
+        char *rp = strchr(lp, ')');
+        if (rp && rp > lp+1) {
+            size_t ilen = (size_t)(rp - lp - 1);
+            char inner[128];
+            if (ilen >= sizeof(inner)) ilen = sizeof(inner)-1;
+            memcpy(inner, lp+1, ilen);
+            inner[ilen] = '\0';
+            // trim inner
+            size_t inlen = strlen(inner);
+            while (inlen > 0 && (unsigned char)inner[inlen-1] < 32) inner[--inlen] = '\0';
+            // if inner starts with digits or looks like a simple tile id, treat as floor under token
+            if (inlen > 0 && (isdigit((unsigned char)inner[0]) || (isalpha((unsigned char)inner[0]) && strlen(inner) <= 3))) {
+                if (isdigit((unsigned char)inner[0])) snprintf(under, TOKEN_SIZE, "%02d", atoi(inner));
+                else { strncpy(under, inner, TOKEN_SIZE-1); under[TOKEN_SIZE-1] = '\0'; }
+            } else if (inlen > 0) {
+                // treat as comma-separated options for NPCs: hostile, hp=##, drop=ID, lvl=#, say=...
+                snprintf(opts_str, sizeof(opts_str), "%s", inner);
+            }
+            *lp = '\0';
+        }
+    }
+    // trim core trailing control
+    size_t clen = strlen(core);
+    while (clen > 0 && (unsigned char)core[clen-1] < 32) core[--clen] = '\0';
+
+    // normalize main/core token
+    char norm_main[TOKEN_SIZE];
+    if (clen > 0 && isdigit((unsigned char)core[0])) snprintf(norm_main, TOKEN_SIZE, "%02d", atoi(core));
+    else { strncpy(norm_main, core, TOKEN_SIZE-1); norm_main[TOKEN_SIZE-1] = '\0'; }
+
+    // the tile shown under this cell: 'under' if provided, else a numeric main token, otherwise "00"
+    const char* floor_token = under[0] ? under : isdigit((unsigned char)norm_main[0]) ? norm_main : "00";
+    if (!grow((void**)&b->cells, &b->cell_cap, b->cell_count + 1, sizeof(uint16_t))) return FALSE;
+    b->cells[b->cell_count++] = builder_token(b, floor_token);
+
+    // player spawn
+    if (core[0] == 'P' || core[0] == 'p') { b->player_row = r; b->player_col = c; }
+    // NPC (any other letter)
+    else if (isalpha((unsigned char)core[0])) {
+        if (!grow((void**)&b->npcs, &b->npc_cap, b->npc_count + 1, sizeof(LevelNpcSpawn))) return FALSE;
+        LevelNpcSpawn* n = &b->npcs[b->npc_count++];
+        memset(n, 0, sizeof(*n));
+        n->id = core[0];
+        n->row = r; n->col = c;
+        n->max_hp = 10; n->hp = n->max_hp;
+        n->level_on_kill = 1;
+        apply_options(b, n, opts_str);
+    }
+    return TRUE;
+}
+
+// the sidecar for levels/x.txt is levels/x.meta (levels/x.txt.meta is also accepted)
+static FILE* open_meta(const char* path, char* meta_path, size_t size) {
+    snprintf(meta_path, size, "%s", path);
+    char* dot = strrchr(meta_path, '.');
+    char* slash = strrchr(meta_path, '/');
+    if (dot && (!slash || dot > slash)) {
+        *dot = '\0';
+        strncat(meta_path, ".meta", size - strlen(meta_path) - 1);
+        FILE* f = fopen(meta_path, "r");
+        if (f) return f;
+    }
+    snprintf(meta_path, size, "%s.meta", path);
+    return fopen(meta_path, "r");
+}
+
+static void apply_meta(LevelBuilder* b, const char* path) {
+    char meta_path[512];
+    FILE* mf = open_meta(path, meta_path, sizeof(meta_path));
+    if (!mf) return;
+    char mline[256];
+    while (fgets(mline, sizeof(mline), mf)) {
+        // skip comments and blank
+        char *s = mline; while (*s && (unsigned char)*s <= 32) s++;
+        if (*s == '\0' || *s == '#') continue;
+        // expected format: row,col: OPTIONS
+        int mx=0,my=0; char *colon = strchr(s, ':');
+        if (!colon) continue;
+        *colon = '\0';
+        if (sscanf(s, "%d,%d", &my, &mx) != 2) continue;
+        char *opts = colon+1; while (*opts && (unsigned char)*opts <= 32) opts++;
+        if (strncasecmp(opts, "light", 5) == 0) { add_light(b, my, mx, opts + 5); continue; }
+        // first NPC spawned at that tile
+        for (int i = 0; i < b->npc_count; ++i) {
+            if (b->npcs[i].row == my && b->npcs[i].col == mx) { apply_options(b, &b->npcs[i], opts); break; }
+        }
+    }
+    fclose(mf);
+}
+
+int level_parse_text(const char* path, LevelData* out) {
+    memset(out, 0, sizeof(*out));
+    FILE* f = fopen(path, "r");
+    if (!f) return FALSE;
+    LevelBuilder b; memset(&b, 0, sizeof(b));
+    b.player_row = b.player_col = -1;
+    // token 0 is the empty cell and string offset 0 is ""
+    if (!grow((void**)&b.tokens, &b.token_cap, 1, TOKEN_SIZE) || !grow((void**)&b.strings, &b.strings_cap, 1, 1)) {
+        builder_free(&b); fclose(f); return FALSE;
+    }
+    b.tokens[0][0] = '\0'; b.token_count = 1;
+    b.strings[0] = '\0'; b.strings_size = 1;
+
+    char* line = NULL; int line_cap = 0;
+    int ok = TRUE, max_cols = 0;
+    while (ok && read_line(f, &line, &line_cap)) {
+        // skip markdown/code-fence lines if the level file was wrapped in fences
+        char *start = line; while (*start && (unsigned char)*start <= 32) start++;
+        if (start[0] == '`' && start[1] == '`' && start[2] == '`') continue;
+        if (!grow_rows(&b)) { ok = FALSE; break; }
+        b.row_start[b.rows] = b.cell_count;
+        int c = 0;
+        char *scan = line;
+        for (;;) {
+            // skip whitespace
+            while (*scan && (*scan == ' ' || *scan == '\t')) scan++;
+            if (!*scan) break;
+            char tokenbuf[512]; int ti = 0;
+            int depth = 0; // parentheses depth
+            while (*scan) {
+                if ((*scan == ' ' || *scan == '\t') && depth == 0) break;
+                if (*scan == '(') { depth++; tokenbuf[ti++] = *scan++; continue; }
+                if (*scan == ')') { tokenbuf[ti++] = *scan++; if (depth > 0) depth--; break; }
+                tokenbuf[ti++] = *scan++;
+                if (ti >= (int)sizeof(tokenbuf)-1) break;
+            }
+            tokenbuf[ti] = '\0';
+            // trim trailing control characters (e.g. '\r') from token
+            while (ti > 0 && (unsigned char)tokenbuf[ti-1] < 32) tokenbuf[--ti] = '\0';
+            if (!parse_cell(&b, tokenbuf, b.rows, c)) { ok = FALSE; break; }
+            c++;
+        }
+        b.row_len[b.rows++] = c;
+        if (c > max_cols) max_cols = c;
+    }
+    free(line);
+    fclose(f);
+    if (!ok) { builder_free(&b); return FALSE; }
+
+    apply_meta(&b, path);
+    // lights of a meta line off the map light nothing (and a compiled level may not hold them)
+    int lights_kept = 0;
+    for (int i = 0; i < b.light_count; ++i)
+        if (b.lights[i].row >= 0 && b.lights[i].row < b.rows && b.lights[i].col >= 0 && b.lights[i].col < max_cols) b.lights[lights_kept++] = b.lights[i];
+    b.light_count = lights_kept;
+
+    // lay the rows out as a rectangular plane; short rows are padded with empty cells
+    uint16_t* tiles = calloc((size_t)b.rows * max_cols + 1, sizeof(uint16_t));
+    uint8_t* collision = calloc((size_t)b.rows * LEVEL_COLLISION_STRIDE(max_cols) + 1, 1);
+    if (!tiles || !collision) { free(tiles); free(collision); builder_free(&b); return FALSE; }
+    for (int r = 0; r < b.rows; ++r)
+        memcpy(tiles + (size_t)r * max_cols, b.cells + b.row_start[r], sizeof(uint16_t) * (size_t)b.row_len[r]);
+    // NPCs and the player stand on plain floor
+    uint16_t plain_floor = builder_token(&b, "00");
+    for (int i = 0; i < b.npc_count; ++i) tiles[(size_t)b.npcs[i].row * max_cols + b.npcs[i].col] = plain_floor;
+    if (b.player_row >= 0) tiles[(size_t)b.player_row * max_cols + b.player_col] = plain_floor;
+    for (int r = 0; r < b.rows; ++r)
+        for (int c = 0; c < max_cols; ++c)
+            if (level_token_is_solid(b.tokens[tiles[(size_t)r * max_cols + c]]))
+                collision[(size_t)r * LEVEL_COLLISION_STRIDE(max_cols) + c / 8] |= (uint8_t)(1 << (c % 8));
+
+    out->rows = b.rows; out->cols = max_cols;
+    out->player_row = b.player_row; out->player_col = b.player_col;
+    out->token_count = b.token_count; out->tokens = (const char (*)[TOKEN_SIZE])b.tokens;
+    out->tiles = tiles; out->collision = collision;
+    out->npc_count = b.npc_count; out->npcs = b.npcs;
+    out->strings = b.strings; out->strings_size = b.strings_size;
+    out->light_count = b.light_count; out->lights = b.lights;
+    out->owned[0] = b.tokens; out->owned[1] = tiles; out->owned[2] = collision;
+    out->owned[3] = b.npcs; out->owned[4] = b.strings; out->owned[5] = b.lights;
+    free(b.cells); free(b.row_start); free(b.row_len);
+    return TRUE;
+}
+
+static uint32_t align4(uint32_t n) { return (n + 3u) & ~3u; }
+
+int level_write_binary(const LevelData* lv, const char* path) {
+    LevelFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, LEVEL_MAGIC, 4);
+    h.version = LEVEL_VERSION;
+    h.rows = (uint32_t)lv->rows; h.cols = (uint32_t)lv->cols;
+    h.player_row = lv->player_row; h.player_col = lv->player_col;
+    h.token_count = (uint32_t)lv->token_count;
+    h.npc_count = (uint32_t)lv->npc_count;
+    h.strings_size = (uint32_t)lv->strings_size;
+    h.light_count = (uint32_t)lv->light_count;
+    size_t tiles_size = sizeof(uint16_t) * (size_t)lv->rows * lv->cols;
+    size_t collision_size = (size_t)lv->rows * LEVEL_COLLISION_STRIDE(lv->cols);
+    h.tokens_off = align4(sizeof(h));
+    h.tiles_off = align4(h.tokens_off + (uint32_t)(TOKEN_SIZE * lv->token_count));
+    h.collision_off = align4(h.tiles_off + (uint32_t)tiles_size);
+    h.npcs_off = align4(h.collision_off + (uint32_t)collision_size);
+    h.strings_off = align4(h.npcs_off + (uint32_t)(sizeof(LevelNpcSpawn) * lv->npc_count));
+    h.lights_off = align4(h.strings_off + h.strings_size);
+    h.file_size = h.lights_off + (uint32_t)(sizeof(LevelLight) * lv->light_count);
+
+    struct { uint32_t off; const void* data; size_t size; } sections[] = {
+        { 0, &h, sizeof(h) },
+        { h.tokens_off, lv->tokens, (size_t)TOKEN_SIZE * lv->token_count },
+        { h.tiles_off, lv->tiles, tiles_size },
+        { h.collision_off, lv->collision, collision_size },
+        { h.npcs_off, lv->npcs, sizeof(LevelNpcSpawn) * lv->npc_count },
+        { h.strings_off, lv->strings, h.strings_size },
+        { h.lights_off, lv->lights, sizeof(LevelLight) * lv->light_count },
+    };
+    FILE* f = fopen(path, "wb");
+    if (!f) return FALSE;
+    static const char zeros[4] = {0};
+    uint32_t pos = 0;
+    int ok = TRUE;
+    for (size_t i = 0; i < sizeof(sections)/sizeof(sections[0]) && ok; ++i) {
+        if (sections[i].off > pos) ok = fwrite(zeros, 1, sections[i].off - pos, f) == sections[i].off - pos;
+        if (ok && sections[i].size) ok = fwrite(sections[i].data, 1, sections[i].size, f) == sections[i].size;
+        pos = sections[i].off + (uint32_t)sections[i].size;
+    }
+    if (fclose(f) != 0) ok = FALSE;
+    return ok;
+}
+
+// map (or, without mmap, read) a whole file
+static void* map_file(const char* path, size_t* size) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void* p = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) p = NULL;
+        else *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return p;
+#else
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void* p = n > 0 ? malloc((size_t)n) : NULL;
+    if (p && fread(p, 1, (size_t)n, f) != (size_t)n) { free(p); p = NULL; }
+    fclose(f);
+    if (p) *size = (size_t)n;
+    return p;
+#endif
+}
+
+static void unmap_file(void* p, size_t size) {
+#ifndef _WIN32
+    munmap(p, size);
+#else
+    (void)size;
+    free(p);
+#endif
+}
+
+// section [off, off + size) lies inside the file and is 4-byte aligned
+static int section_ok(const LevelFileHeader* h, uint32_t off, uint64_t size) {
+    return off % 4 == 0 && off >= sizeof(*h) && (uint64_t)off + size <= h->file_size;
+}
+
+// (row, col) is a tile of a rows x cols level
+static int cell_ok(const LevelFileHeader* h, int32_t row, int32_t col) {
+    return row >= 0 && col >= 0 && (uint32_t)row < h->rows && (uint32_t)col < h->cols;
+}
+
+// what the sections hold, once they are known to be inside the file: terminated strings,
+// tile values naming a token, positions inside the level
+static int contents_ok(const LevelFileHeader* h, const uint8_t* base) {
+    const char (*tokens)[TOKEN_SIZE] = (const char (*)[TOKEN_SIZE])(base + h->tokens_off);
+    if (tokens[0][0] != '\0') return FALSE;
+    for (uint32_t i = 0; i < h->token_count; ++i) if (memchr(tokens[i], '\0', TOKEN_SIZE) == NULL) return FALSE;
+    const uint16_t* tiles = (const uint16_t*)(base + h->tiles_off);
+    for (size_t i = 0, n = (size_t)h->rows * h->cols; i < n; ++i) if (tiles[i] >= h->token_count) return FALSE;
+    const LevelNpcSpawn* npcs = (const LevelNpcSpawn*)(base + h->npcs_off);
+    for (uint32_t i = 0; i < h->npc_count; ++i) {
+        const LevelNpcSpawn* n = &npcs[i];
+        if (!cell_ok(h, n->row, n->col) || n->dialog >= h->strings_size || memchr(n->drop_id, '\0', sizeof(n->drop_id)) == NULL) return FALSE;
+    }
+    if ((h->player_row != -1 || h->player_col != -1) && !cell_ok(h, h->player_row, h->player_col)) return FALSE;
+    const LevelLight* lights = (const LevelLight*)(base + h->lights_off);
+    for (uint32_t i = 0; i < h->light_count; ++i) if (!cell_ok(h, lights[i].row, lights[i].col)) return FALSE;
+    return TRUE;
+}
+
+int level_load_binary(const char* path, LevelData* out) {
+    memset(out, 0, sizeof(*out));
+    size_t size = 0;
+    void* map = map_file(path, &size);
+    if (!map) return FALSE;
+    const LevelFileHeader* h = map;
+    const uint8_t* base = map;
+    int ok = size >= sizeof(*h) && memcmp(h->magic, LEVEL_MAGIC, 4) == 0 && h->version == LEVEL_VERSION
+        && h->file_size == size && h->token_count >= 1 && h->strings_size >= 1
+        && section_ok(h, h->tokens_off, (uint64_t)TOKEN_SIZE * h->token_count)
+        && section_ok(h, h->tiles_off, sizeof(uint16_t) * (uint64_t)h->rows * h->cols)
+        && section_ok(h, h->collision_off, (uint64_t)h->rows * LEVEL_COLLISION_STRIDE((uint64_t)h->cols))
+        && section_ok(h, h->npcs_off, sizeof(LevelNpcSpawn) * (uint64_t)h->npc_count)
+        && section_ok(h, h->strings_off, h->strings_size)
+        && section_ok(h, h->lights_off, sizeof(LevelLight) * (uint64_t)h->light_count)
+        && base[h->strings_off + h->strings_size - 1] == '\0'
+        && contents_ok(h, base);
+    if (!ok) {
+        fprintf(stderr, "Invalid or outdated compiled level '%s'\n", path);
+        unmap_file(map, size);
+        return FALSE;
+    }
+    out->rows = (int)h->rows; out->cols = (int)h->cols;
+    out->player_row = h->player_row; out->player_col = h->player_col;
+    out->token_count = (int)h->token_count;
+    out->tokens = (const char (*)[TOKEN_SIZE])(base + h->tokens_off);
+    out->tiles = (const uint16_t*)(base + h->tiles_off);
+    out->collision = base + h->collision_off;
+    out->npc_count = (int)h->npc_count;
+    out->npcs = (const LevelNpcSpawn*)(base + h->npcs_off);
+    out->strings = (const char*)(base + h->strings_off);
+    out->strings_size = (int)h->strings_size;
+    out->light_count = (int)h->light_count;
+    out->lights = (const LevelLight*)(base + h->lights_off);
+    out->map = map; out->map_size = size;
+    return TRUE;
+}
+
+static int file_mtime(const char* path, time_t* t) {
+    struct stat st;
+    if (stat(path, &st) != 0) return FALSE;
+    *t = st.st_mtime;
+    return TRUE;
+}
+
+int level_load(const char* path, LevelData* out) {
+    size_t len = strlen(path);
+    if (len > 5 && strcmp(path + len - 5, ".lvlb") == 0) return level_load_binary(path, out);
+    // prefer levels/x.lvlb over levels/x.txt when it was compiled after the text and meta changed
+    // (strictly after: times are whole seconds, and an edit in the second it was compiled wins)
+    char bin_path[512], meta_path[512];
+    snprintf(bin_path, sizeof(bin_path), "%s", path);
+    char* dot = strrchr(bin_path, '.');
+    char* slash = strrchr(bin_path, '/');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    strncat(bin_path, ".lvlb", sizeof(bin_path) - strlen(bin_path) - 1);
+    time_t bin_time, src_time, meta_time;
+    if (file_mtime(bin_path, &bin_time) && file_mtime(path, &src_time) && bin_time > src_time) {
+        FILE* mf = open_meta(path, meta_path, sizeof(meta_path));
+        if (mf) fclose(mf);
+        if ((!mf || (file_mtime(meta_path, &meta_time) && bin_time > meta_time)) && level_load_binary(bin_path, out)) return TRUE;
+    }
+    return level_parse_text(path, out);
+}
+
+void level_free(LevelData* lv) {
+    if (lv->map) unmap_file(lv->map, lv->map_size);
+    for (int i = 0; i < (int)(sizeof(lv->owned) / sizeof(lv->owned[0])); ++i) free(lv->owned[i]);
+    memset(lv, 0, sizeof(*lv));
+}
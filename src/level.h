@@ -0,0 +1,91 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <stdint.h>
+#include "./constants.h"
+
+// Compiled level file (.lvlb), little-endian. Every section starts on a 4-byte boundary so
+// the loader can use the mapped file in place:
+//   header | token table | tile plane | collision bitset | NPC spawn table | string table | lights
+#define LEVEL_MAGIC "LVLB"
+#define LEVEL_VERSION 2
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t file_size;
+    uint32_t rows, cols;
+    int32_t player_row, player_col; // -1 when the level has no P
+    uint32_t token_count;   // token 0 is always "" (empty cell)
+    uint32_t npc_count;
+    uint32_t strings_size;
+    uint32_t tokens_off;    // token_count * char[TOKEN_SIZE]
+    uint32_t tiles_off;     // rows * cols uint16_t token indices, row-major
+    uint32_t collision_off; // rows * LEVEL_COLLISION_STRIDE(cols) bytes, bit c%8 of byte c/8
+    uint32_t npcs_off;      // npc_count * LevelNpcSpawn
+    uint32_t strings_off;   // NUL-terminated strings; offset 0 is ""
+    uint32_t light_count;
+    uint32_t lights_off;    // light_count * LevelLight
+} LevelFileHeader;
+
+#define LEVEL_COLLISION_STRIDE(cols) (((cols) + 7) / 8)
+
+typedef struct {
+    int32_t row, col;
+    int32_t hp, max_hp;
+    int32_t level_on_kill;
+    uint32_t dialog;  // offset into the string table
+    char drop_id[8];
+    char id;          // letter
+    uint8_t hostile;
+    uint8_t pad[2];
+} LevelNpcSpawn;
+
+// static light source (meta: "row,col: light, radius=6, color=ffc080")
+typedef struct {
+    int32_t row, col;
+    int32_t radius; // in tiles
+    uint8_t r, g, b;
+    uint8_t pad;
+} LevelLight;
+
+// a parsed or mapped level. Arrays point into the mapped file or into buffers owned by the
+// LevelData; either way level_free releases them.
+typedef struct {
+    int rows, cols;
+    int player_row, player_col;
+    int token_count;
+    const char (*tokens)[TOKEN_SIZE];
+    const uint16_t* tiles;
+    const uint8_t* collision;
+    int npc_count;
+    const LevelNpcSpawn* npcs;
+    const char* strings;
+    int strings_size;
+    int light_count;
+    const LevelLight* lights;
+    // ownership
+    void* map;        // mapped (or read) .lvlb file
+    size_t map_size;
+    void* owned[6];   // buffers built by the text parser
+} LevelData;
+
+// which tile tokens block movement
+int level_token_is_solid(const char* token);
+// parse a text level and its .meta sidecar
+int level_parse_text(const char* path, LevelData* out);
+// map a compiled level; fails on a bad magic, version or section bounds
+int level_load_binary(const char* path, LevelData* out);
+int level_write_binary(const LevelData* lv, const char* path);
+// read whichever is current: the .lvlb next to a .txt when it is at least as new, else the text
+int level_load(const char* path, LevelData* out);
+void level_free(LevelData* lv);
+
+static inline int level_is_solid(const LevelData* lv, int r, int c) {
+    return (lv->collision[r * LEVEL_COLLISION_STRIDE(lv->cols) + c / 8] >> (c % 8)) & 1;
+}
+static inline const char* level_string(const LevelData* lv, uint32_t off) {
+    return off < (uint32_t)lv->strings_size ? lv->strings + off : "";
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "./constants.h"
+#include "./level.h"
+#include "./world.h"
+#include "./lighting.h"
+
+// light values are 4 uint16 lanes per tile (r, g, b, a) on a 0-255 scale; sums may exceed 255
+// and are clamped only when packed into the texture
+#define CHUNK_LANES (WORLD_CHUNK_TILES * WORLD_CHUNK_TILES * 4)
+
+static const LevelData* level = NULL; // NULL: lighting off
+static uint16_t* chunk_light = NULL;  // baked static light per world chunk slot
+static int chunk_slots = 0;
+static uint16_t* acc = NULL;          // the frame's light map, win_rows x win_cols tiles
+static int acc_cap = 0;
+static uint16_t* scratch = NULL;      // one light's contribution to one row
+static int scratch_cap = 0;
+static int win_r0, win_c0, win_rows, win_cols;
+static SDL_Texture* tex = NULL;
+static int tex_w = 0, tex_h = 0;
+
+static int grow_lanes(uint16_t** p, int* cap, int need) {
+    if (need <= *cap) return TRUE;
+    uint16_t* q = realloc(*p, sizeof(uint16_t) * (size_t)need);
+    if (!q) return FALSE;
+    *p = q; *cap = need;
+    return TRUE;
+}
+
+// dst += src, lane by lane, saturating at 0x7FFF (so the signed pack below still clamps to 255)
+static void add_lanes(uint16_t* dst, const uint16_t* src, int n) {
+    int k = 0;
+#ifdef __SSE2__
+    for (; k + 8 <= n; k += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + k));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + k));
+        _mm_storeu_si128((__m128i*)(dst + k), _mm_adds_epi16(a, b));
+    }
+#endif
+    for (; k < n; ++k) {
+        int v = dst[k] + src[k];
+        dst[k] = (uint16_t)(v > 0x7FFF ? 0x7FFF : v);
+    }
+}
+
+// 16-bit lanes -> 8-bit texels, clamped to 255
+static void pack_lanes(uint8_t* dst, const uint16_t* src, int n) {
+    int k = 0;
+#ifdef __SSE2__
+    for (; k + 16 <= n; k += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + k));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + k + 8));
+        _mm_storeu_si128((__m128i*)(dst + k), _mm_packus_epi16(a, b));
+    }
+#endif
+    for (; k < n; ++k) dst[k] = (uint8_t)(src[k] > 255 ? 255 : src[k]);
+}
+
+static int level_solid(int r, int c) {
+    if (r < 0 || c < 0 || r >= level->rows || c >= level->cols) return TRUE;
+    return level_is_solid(level, r, c);
+}
+
+// no solid tile strictly between the two tiles on the line joining them
+static int tile_visible(int r0, int c0, int r1, int c1) {
+    int dr = abs(r1 - r0), dc = abs(c1 - c0);
+    int sr = r0 < r1 ? 1 : -1, sc = c0 < c1 ? 1 : -1;
+    int err = dc - dr, r = r0, c = c0;
+    while (r != r1 || c != c1) {
+        int e2 = 2 * err;
+        if (e2 > -dr) { err -= dr; c += sc; }
+        if (e2 < dc) { err += dc; r += sr; }
+        if ((r != r1 || c != c1) && level_solid(r, c)) return FALSE;
+    }
+    return TRUE;
+}
+
+// contribution of a light centered at (lr, lc) (tile units, light tile (sr, sc)) to tiles
+// [c0, c1) of row r, written to scratch
+static void light_row(int r, int c0, int c1, float lr, float lc, float radius, int sr, int sc, SDL_Color color) {
+    float inv = 1.0f / (radius * radius);
+    float dy = (float)r + 0.5f - lr;
+    for (int c = c0; c < c1; ++c) {
+        uint16_t* o = scratch + (c - c0) * 4;
+        float dx = (float)c + 0.5f - lc;
+        float f = 1.0f - (dx * dx + dy * dy) * inv;
+        if (f <= 0.0f || !tile_visible(sr, sc, r, c)) { o[0] = o[1] = o[2] = o[3] = 0; continue; }
+        o[0] = (uint16_t)(color.r * f); o[1] = (uint16_t)(color.g * f); o[2] = (uint16_t)(color.b * f); o[3] = 0;
+    }
+}
+
+// add a light to the tiles of a map with `cols` columns whose top-left tile is (r0, c0),
+// limited to rows x cols from there
+static void splat(uint16_t* map, int r0, int c0, int rows, int cols, float lr, float lc, float radius, SDL_Color color) {
+    if (radius <= 0.0f) return;
+    int sr = (int)floorf(lr), sc = (int)floorf(lc);
+    int ra = (int)floorf(lr - radius), rb = (int)floorf(lr + radius);
+    int ca = (int)floorf(lc - radius), cb = (int)floorf(lc + radius);
+    if (ra < r0) ra = r0;
+    if (rb > r0 + rows - 1) rb = r0 + rows - 1;
+    if (ca < c0) ca = c0;
+    if (cb > c0 + cols - 1) cb = c0 + cols - 1;
+    if (ra > rb || ca > cb || !grow_lanes(&scratch, &scratch_cap, (cb - ca + 1) * 4)) return;
+    for (int r = ra; r <= rb; ++r) {
+        light_row(r, ca, cb + 1, lr, lc, radius, sr, sc, color);
+        add_lanes(map + ((size_t)(r - r0) * cols + (ca - c0)) * 4, scratch, (cb - ca + 1) * 4);
+    }
+}
+
+void light_set_level(const LevelData* lv) {
+    free(chunk_light);
+    chunk_light = NULL;
+    chunk_slots = 0;
+    level = lv && lv->light_count > 0 ? lv : NULL;
+    if (!level) return;
+    chunk_light = malloc(sizeof(uint16_t) * CHUNK_LANES * (size_t)world.slot_count);
+    if (!chunk_light) { level = NULL; return; }
+    chunk_slots = world.slot_count;
+}
+
+void light_free(void) {
+    light_set_level(NULL);
+    free(acc); acc = NULL; acc_cap = 0;
+    free(scratch); scratch = NULL; scratch_cap = 0;
+    if (tex) SDL_DestroyTexture(tex);
+    tex = NULL; tex_w = tex_h = 0;
+}
+
+int light_active(void) { return level != NULL; }
+
+void light_bake_chunk(int slot) {
+    if (!level || slot < 0 || slot >= chunk_slots) return;
+    const WorldChunk* ch = &world.slots[slot];
+    uint16_t* out = chunk_light + (size_t)slot * CHUNK_LANES;
+    memset(out, 0, sizeof(uint16_t) * CHUNK_LANES);
+    int r0 = ch->cr * WORLD_CHUNK_TILES, c0 = ch->cc * WORLD_CHUNK_TILES;
+    for (int i = 0; i < level->light_count; ++i) {
+        const LevelLight* l = &level->lights[i];
+        SDL_Color color = { l->r, l->g, l->b, 255 };
+        splat(out, r0, c0, WORLD_CHUNK_TILES, WORLD_CHUNK_TILES, (float)l->row + 0.5f, (float)l->col + 0.5f, (float)l->radius, color);
+    }
+}
+
+void light_begin(int r0, int c0, int rows, int cols) {
+    win_r0 = r0; win_c0 = c0; win_rows = rows; win_cols = cols;
+    if (!level || !grow_lanes(&acc, &acc_cap, rows * cols * 4)) { win_rows = win_cols = 0; return; }
+    for (int i = 0; i < rows * cols; ++i) {
+        uint16_t* o = acc + i * 4;
+        o[0] = o[1] = o[2] = LIGHT_AMBIENT; o[3] = 255;
+    }
+    // the baked static light, one chunk-wide span at a time
+    for (int r = r0 > 0 ? r0 : 0; r < r0 + rows && r < level->rows; ++r) {
+        for (int c = c0 > 0 ? c0 : 0; c < c0 + cols && c < level->cols; ) {
+            int span_end = (c / WORLD_CHUNK_TILES + 1) * WORLD_CHUNK_TILES;
+            if (span_end > c0 + cols) span_end = c0 + cols;
+            if (span_end > level->cols) span_end = level->cols;
+            int slot = world.directory[(r / WORLD_CHUNK_TILES) * world.chunk_cols + c / WORLD_CHUNK_TILES];
+            if (slot >= 0 && slot < chunk_slots) {
+                const uint16_t* baked = chunk_light + (size_t)slot * CHUNK_LANES + ((r % WORLD_CHUNK_TILES) * WORLD_CHUNK_TILES + c % WORLD_CHUNK_TILES) * 4;
+                add_lanes(acc + ((size_t)(r - r0) * cols + (c - c0)) * 4, baked, (span_end - c) * 4);
+            }
+            c = span_end;
+        }
+    }
+}
+
+void light_add(float x, float y, float radius, SDL_Color color) {
+    if (!level || win_rows <= 0) return;
+    splat(acc, win_r0, win_c0, win_rows, win_cols, y / TILE_SIZE, x / TILE_SIZE, radius / TILE_SIZE, color);
+}
+
+void light_draw(SDL_Renderer* renderer, float x, float y, float tile_px) {
+    if (!level || win_rows <= 0 || !renderer) return;
+    if (!tex || tex_w != win_cols || tex_h != win_rows) {
+        if (tex) SDL_DestroyTexture(tex);
+        tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, win_cols, win_rows);
+        if (!tex) return;
+        tex_w = win_cols; tex_h = win_rows;
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_MOD);
+        // smooth the tile-sized texels into gradients
+        SDL_SetTextureScaleMode(tex, SDL_ScaleModeLinear);
+    }
+    void* pixels; int pitch;
+    if (SDL_LockTexture(tex, NULL, &pixels, &pitch) != 0) return;
+    for (int r = 0; r < win_rows; ++r)
+        pack_lanes((uint8_t*)pixels + (size_t)r * pitch, acc + (size_t)r * win_cols * 4, win_cols * 4);
+    SDL_UnlockTexture(tex);
+    SDL_FRect dst = { x, y, win_cols * tile_px, win_rows * tile_px };
+    SDL_RenderCopyF(renderer, tex, NULL, &dst);
+}
@@ -0,0 +1,30 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <SDL2/SDL.h>
+#include "./level.h"
+
+// Tile-resolution light map. A level's static lights are baked per world chunk when the chunk
+// streams in; every frame the visible window starts from those baked values plus the ambient
+// level, dynamic lights are added on top (saturating 16-bit adds, SSE2 where available), and
+// the result is uploaded to one streaming texture that is multiplied over the scene. Solid
+// tiles block light; a wall facing a light is lit itself.
+//
+// Levels without static lights are drawn unlit (lighting stays off).
+
+// use lv's static lights and collision for the world's current chunk slots (NULL: off)
+void light_set_level(const LevelData* lv);
+void light_free(void);
+int light_active(void);
+// bake the static lights falling on a freshly loaded world chunk
+void light_bake_chunk(int slot);
+
+// start a frame's light map over rows x cols tiles from tile (r0, c0)
+void light_begin(int r0, int c0, int rows, int cols);
+// dynamic light at pixel position (x, y) with a radius in pixels
+void light_add(float x, float y, float radius, SDL_Color color);
+// upload the light map and multiply it over what has been drawn: top-left tile at screen
+// position (x, y), tiles tile_px screen pixels wide
+void light_draw(SDL_Renderer* renderer, float x, float y, float tile_px);
+
+#endif
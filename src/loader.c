@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "./constants.h"
+#include "./atlas.h"
+#include "./level.h"
+#include "./loader.h"
+
+static SDL_Thread* thread = NULL;
+static SDL_atomic_t status; // LOADER_*; the worker publishes READY/FAILED last
+static char job_path[512];
+static char (*job_known)[TOKEN_SIZE] = NULL;
+static int job_known_count = 0;
+static LoaderImageInfo job_info = NULL;
+static LevelData job_level;
+static LoaderImage* images = NULL;
+static int image_count = 0, image_cap = 0;
+
+static int is_known(const char* token) {
+    for (int i = 0; i < job_known_count; ++i) if (strcmp(job_known[i], token) == 0) return TRUE;
+    for (int i = 0; i < image_count; ++i) if (strcmp(images[i].token, token) == 0) return TRUE;
+    return FALSE;
+}
+
+// queue a token's image for decoding unless the game (or this job) already has it
+static void want_image(const char* token) {
+    if (!token[0] || is_known(token)) return;
+    if (image_count == image_cap) {
+        int cap = image_cap ? image_cap * 2 : 32;
+        LoaderImage* p = realloc(images, sizeof(LoaderImage) * (size_t)cap);
+        if (!p) return;
+        images = p; image_cap = cap;
+    }
+    LoaderImage* im = &images[image_count++];
+    strncpy(im->token, token, TOKEN_SIZE - 1); im->token[TOKEN_SIZE - 1] = '\0';
+    im->surface = NULL;
+}
+
+static int loader_thread(void* data) {
+    (void)data;
+    if (!level_load(job_path, &job_level)) { SDL_AtomicSet(&status, LOADER_FAILED); return 1; }
+    if (job_info) {
+        // tiles, NPC letters and the items they drop
+        for (int i = 1; i < job_level.token_count; ++i) want_image(job_level.tokens[i]);
+        for (int i = 0; i < job_level.npc_count; ++i) {
+            char et[2] = { job_level.npcs[i].id, '\0' };
+            want_image(et);
+            char drop[TOKEN_SIZE]; strncpy(drop, job_level.npcs[i].drop_id, TOKEN_SIZE - 1); drop[TOKEN_SIZE - 1] = '\0';
+            want_image(drop);
+        }
+        for (int i = 0; i < image_count; ++i) {
+            char path[512]; int w = 0, h = 0;
+            job_info(images[i].token, path, sizeof(path), &w, &h);
+            SDL_Surface* s = IMG_Load(path);
+            if (!s) continue;
+            images[i].surface = atlas_prepare_surface(s, w, h);
+            SDL_FreeSurface(s);
+        }
+    }
+    SDL_AtomicSet(&status, LOADER_READY);
+    return 0;
+}
+
+int loader_start(const char* path, const char (*known)[TOKEN_SIZE], int known_count, LoaderImageInfo info) {
+    if (thread || SDL_AtomicGet(&status) != LOADER_IDLE) return FALSE;
+    snprintf(job_path, sizeof(job_path), "%s", path);
+    job_known = malloc((size_t)TOKEN_SIZE * (known_count > 0 ? known_count : 1));
+    if (!job_known) return FALSE;
+    memcpy(job_known, known, (size_t)TOKEN_SIZE * known_count);
+    job_known_count = known_count;
+    job_info = info;
+    image_count = 0;
+    memset(&job_level, 0, sizeof(job_level));
+    SDL_AtomicSet(&status, LOADER_RUNNING);
+    thread = SDL_CreateThread(loader_thread, "level-loader", NULL);
+    if (!thread) {
+        fprintf(stderr, "Could not start level loader thread: %s\n", SDL_GetError());
+        // load on this thread instead so the transition still happens
+        loader_thread(NULL);
+    }
+    return TRUE;
+}
+
+int loader_status(void) { return SDL_AtomicGet(&status); }
+
+LoaderImage* loader_images(int* count) {
+    *count = SDL_AtomicGet(&status) == LOADER_READY ? image_count : 0;
+    return images;
+}
+
+LevelData loader_take_level(void) {
+    LevelData lv = job_level;
+    memset(&job_level, 0, sizeof(job_level));
+    return lv;
+}
+
+void loader_finish(void) {
+    if (thread) { SDL_WaitThread(thread, NULL); thread = NULL; }
+    for (int i = 0; i < image_count; ++i) SDL_FreeSurface(images[i].surface);
+    free(images); images = NULL; image_count = image_cap = 0;
+    free(job_known); job_known = NULL; job_known_count = 0;
+    level_free(&job_level);
+    SDL_AtomicSet(&status, LOADER_IDLE);
+}
@@ -0,0 +1,32 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./level.h"
+
+// Background level loading: a worker thread reads/parses the level and decodes and resamples
+// the images of every token the game does not know yet. The main thread then only uploads
+// the prepared surfaces to the atlas (a few per frame) and swaps the level in.
+enum { LOADER_IDLE, LOADER_RUNNING, LOADER_READY, LOADER_FAILED };
+
+typedef struct {
+    char token[TOKEN_SIZE];
+    SDL_Surface* surface; // prepared RGBA32 at atlas size, NULL if the image failed to load
+} LoaderImage;
+
+// image file and atlas size for a token; called on the loader thread, so it must be pure
+typedef void (*LoaderImageInfo)(const char* token, char* path, size_t path_size, int* w, int* h);
+
+// start loading a level. known: tokens the game already has sprites for (copied before the
+// thread starts). info NULL = don't decode images (headless). FALSE if a load is in flight.
+int loader_start(const char* path, const char (*known)[TOKEN_SIZE], int known_count, LoaderImageInfo info);
+int loader_status(void);
+// READY: decoded images; the caller may take (and NULL out) surfaces
+LoaderImage* loader_images(int* count);
+// READY: hand the loaded level to the caller, which must level_free it
+LevelData loader_take_level(void);
+// join the thread and free whatever was not taken; back to IDLE
+void loader_finish(void);
+
+#endif
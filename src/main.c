@@ -7,33 +7,89 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <math.h>
+#include <dirent.h>
 #include "./constants.h"
+#include "./atlas.h"
+#include "./anim.h"
+#include "./batch.h"
+#include "./text.h"
+#include "./spatial.h"
+#include "./npc.h"
+#include "./level.h"
+#include "./world.h"
+#include "./loader.h"
+#include "./profiler.h"
+#include "./jobs.h"
+#include "./flowfield.h"
+#include "./replay.h"
+#include "./lighting.h"
+#include "./camera.h"
+#include "./pool.h"
+#include "./input.h"
+#include "./pacing.h"
+#include "./snapshot.h"
+#include "./watch.h"
 
 // TODO:
 // i want to fix the parsing of meta files (for each level)
 // i want to build the combat system and make some cards and inventory items
-// i want to add lighting
 
 int game_is_running = FALSE;
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
 
-int last_frame_time = 0;
-
-static char level_tiles[MAX_ROWS][MAX_COLS][TOKEN_SIZE];
+// fixed timestep: the simulation always advances in steps of 1/sim_tick_rate seconds,
+// render() draws entities interpolated between the last two ticks by render_alpha
+// (settings and functions only main() uses are left out of builds without it: GAME_NO_MAIN)
+#ifndef GAME_NO_MAIN
+static int sim_tick_rate = SIM_TICK_RATE;
+#endif
+static float render_alpha = 1.0f;
+
+// headless mode: no window, renderer or textures; update() runs as fast as the CPU allows
+static int headless = 0;
+#ifndef GAME_NO_MAIN
+static int headless_ticks = HEADLESS_DEFAULT_TICKS;
+#endif
+static const char* start_level = "levels/level1.txt";
+static int level_debug = 0; // dump each loaded level to stdout (--debug-level)
+static int show_profiler = 0; // F3 toggles the profiler overlay
+static PacingMode pacing = PACING_VSYNC; // --pacing
+static int pacing_fps = 0; // --fps: frame cap for --pacing capped (0 = the display's refresh rate)
+static const char* profile_trace_path = NULL; // --profile-trace: write a trace on exit
+static int job_threads = 0; // --threads: job workers including the main thread (0 = one per CPU)
+static int max_npcs = NPC_MAX_LIMIT; // NPC storage grows on demand up to this (--max-npcs)
+#ifndef GAME_NO_MAIN
+static int hot_reload = 1; // apply edits to level and asset files while running (--no-hot-reload)
+#endif
+
+// recording / replay: the simulation only sees the per-tick input bits and the seed
+static const char* record_path = NULL; // --record: write every tick's input to this file
+static int replaying = 0; // --replay: inputs come from the recording instead of the keyboard
+#ifndef GAME_NO_MAIN
+static uint32_t sim_seed = 0; // seeds NPC randomness (--seed, else picked from the clock)
+static int seed_given = 0;
+static char replay_level[256]; // level named in the replay header
+static uint8_t level_swap_flag = 0; // REPLAY_LEVEL_SWAP while a finished load has not been ticked yet
+static int replay_failed = 0; // the replay's state hashes stopped matching
+#endif
+
+// the current level stays loaded (mapped) while chunks of it stream in and out of `world`
+static LevelData current_level;
+static char level_path[256];     // file current_level was loaded from (snapshots name it)
+static char requested_level[256]; // file the background loader is reading
 static int level_rows = 0;
 static int level_cols = 0;
-// collision map: 1 = solid, 0 = walkable
-static int collision_map[MAX_ROWS][MAX_COLS] = {{0}};
-// pixel offsets to center the level on screen
-static int level_offset_x = 0;
-static int level_offset_y = 0;
+static int residency_radius = WORLD_RESIDENCY_RADIUS; // chunks kept around the player (--residency)
+// world -> screen: follows the player at render_scale, centers small levels
+static Camera camera;
 
 struct player {
     float x;
     float y;
     float width;
     float height;
+    float prev_x, prev_y; // position at the start of the current tick (for interpolation)
 } player;
 
 // --- Inventory / Items ---
@@ -45,7 +101,7 @@ typedef struct {
     ItemType type;
     int stack; // current stack count
     int max_stack; // max allowed
-    SDL_Texture* tex; // cached texture for this item
+    Sprite sprite; // atlas sprite for this item
 } Item;
 
 typedef struct {
@@ -65,7 +121,7 @@ static int player_max_hp = 100;
 static int player_hp = 100;
 static int player_defense_pct = 0; // 0-100 percent damage reduction
 
-// rendering scale (zoom)
+// rendering scale (zoom): screen pixels per world pixel
 static float render_scale = 1.0f;
 static int game_over = 0;
 
@@ -73,114 +129,77 @@ static int game_over = 0;
 typedef struct {
     char id[8];
     float x, y;
-    SDL_Texture* tex;
+    Sprite sprite;
     int stack;
-    int exists;
 } Drop;
 
-static Drop drops[MAX_DROPS];
-static int drop_count = 0;
+static Pool drops; // Drop, MAX_DROPS
+
+// tile-aligned proximity grids; ids are npc slots / drop pool slots, positions are centers
+static SpatialGrid npc_grid;
+static SpatialGrid drop_grid;
 
 // simple HUD message system
-typedef struct { char text[128]; float timer; } HudMsg;
-static HudMsg hud_msgs[HUD_MSG_MAX];
-static int hud_count = 0;
+typedef struct { char text[128]; float timer; uint32_t seq; } HudMsg;
+static Pool hud_msgs; // HudMsg, HUD_MSG_MAX
+static uint32_t hud_seq = 0; // messages are listed in the order they were added
+static PoolHandle dialog_msg = POOL_HANDLE_NONE; // the NPC dialog line on screen, if any
+
+static int cmp_int(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+static int cmp_int_desc(const void* a, const void* b) { return cmp_int(b, a); }
+
+// a full pool makes room by dropping the item with the least time left
+static int pool_add_evicting(Pool* p, size_t timer_offset) {
+    if (p->count >= p->capacity) {
+        int oldest = 0;
+        for (int i = 1; i < p->count; ++i)
+            if (*(float*)((char*)pool_at(p, i) + timer_offset) < *(float*)((char*)pool_at(p, oldest) + timer_offset)) oldest = i;
+        pool_remove(p, oldest);
+    }
+    return pool_add(p);
+}
 
-static void add_hud_message(const char *fmt, ...) {
-    if (hud_count >= (int)(sizeof(hud_msgs)/sizeof(hud_msgs[0]))) return;
+static PoolHandle add_hud_message(const char *fmt, ...) {
+    int slot = pool_add_evicting(&hud_msgs, offsetof(HudMsg, timer));
+    if (slot < 0) return POOL_HANDLE_NONE;
+    HudMsg *m = pool_at(&hud_msgs, slot);
     va_list ap; va_start(ap, fmt);
-    vsnprintf(hud_msgs[hud_count].text, sizeof(hud_msgs[hud_count].text), fmt, ap);
+    vsnprintf(m->text, sizeof(m->text), fmt, ap);
     va_end(ap);
-    hud_msgs[hud_count].timer = 2.5f; // seconds
-    hud_count++;
+    m->timer = 2.5f; // seconds
+    m->seq = hud_seq++;
+    return hud_msgs.handle[slot];
 }
 
 // forward decl to avoid implicit declaration
-static SDL_Texture* load_texture_for_token(const char* token);
+static Sprite load_sprite_for_token(const char* token);
 
+// a drop is lost only when MAX_DROPS items are already lying around uncollected
 static void spawn_drop(const char *id, float x, float y) {
-    if (drop_count >= (int)(sizeof(drops)/sizeof(drops[0]))) return;
-    Drop *d = &drops[drop_count++];
+    int slot = pool_add(&drops);
+    if (slot < 0) return;
+    Drop *d = pool_at(&drops, slot);
     strncpy(d->id, id, sizeof(d->id)-1); d->id[sizeof(d->id)-1] = '\0';
-    d->x = x; d->y = y; d->stack = 1; d->exists = 1;
-    // try load texture for token (item id)
-    d->tex = load_texture_for_token(d->id);
-}
-
-// small 3x5 bitmap font for 0-9 and a few letters (H,P,C,W)
-// each entry is 5 rows of 3 bits (LSB is rightmost pixel)
-static const uint8_t font_3x5_digits[16][5] = {
-    // 0
-    {0b111,0b101,0b101,0b101,0b111},
-    // 1
-    {0b010,0b110,0b010,0b010,0b111},
-    // 2
-    {0b111,0b001,0b111,0b100,0b111},
-    // 3
-    {0b111,0b001,0b111,0b001,0b111},
-    // 4
-    {0b101,0b101,0b111,0b001,0b001},
-    // 5
-    {0b111,0b100,0b111,0b001,0b111},
-    // 6
-    {0b111,0b100,0b111,0b101,0b111},
-    // 7
-    {0b111,0b001,0b010,0b100,0b100},
-    // 8
-    {0b111,0b101,0b111,0b101,0b111},
-    // 9
-    {0b111,0b101,0b111,0b001,0b111},
-    // 10: H
-    {0b101,0b101,0b111,0b101,0b101},
-    // 11: P
-    {0b111,0b101,0b111,0b100,0b100},
-    // 12: C
-    {0b111,0b100,0b100,0b100,0b111},
-    // 13: W
-    {0b101,0b101,0b101,0b111,0b101},
-    // 14: ':'
-    {0b000,0b010,0b000,0b010,0b000},
-    // 15: '/'
-    {0b001,0b001,0b010,0b100,0b100}
-};
-
-static int char_to_font_index(char ch) {
-    if (ch >= '0' && ch <= '9') return ch - '0';
-    if (ch == 'H') return 10;
-    if (ch == 'P') return 11;
-    if (ch == 'C') return 12;
-    if (ch == 'W') return 13;
-    if (ch == ':') return 14;
-    if (ch == '/') return 15;
-    return -1;
-}
-
-static void draw_char_small(int x, int y, int scale, SDL_Color color, char ch) {
-    int idx = char_to_font_index(ch);
-    if (idx < 0) return;
-    const uint8_t *glyph = font_3x5_digits[idx];
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    for (int row = 0; row < 5; ++row) {
-        for (int col = 0; col < 3; ++col) {
-            if (glyph[row] & (1 << (2-col))) {
-                SDL_Rect r = { x + col*scale, y + row*scale, scale, scale };
-                SDL_RenderFillRect(renderer, &r);
-            }
-        }
-    }
+    d->x = x; d->y = y; d->stack = 1;
+    spatial_insert(&drop_grid, slot, x, y);
+    // try load sprite for token (item id)
+    d->sprite = load_sprite_for_token(d->id);
 }
 
-static void draw_string_small(int x, int y, int scale, SDL_Color color, const char *s) {
-    int ox = x;
-    while (*s) {
-        if (*s == ' ') { ox += (3 + 1) * scale; s++; continue; }
-        draw_char_small(ox, y, scale, color, *s);
-        ox += (3 + 1) * scale; s++;
-    }
+static void remove_drop(int slot) {
+    spatial_remove(&drop_grid, slot);
+    int moved = pool_remove(&drops, slot);
+    if (moved >= 0) spatial_rename(&drop_grid, moved, slot);
 }
 
-// helper: draw TTF text at given position (size param chooses font size via TTF_OpenFont if needed)
-// draw_text_ttf is defined after ui_font to avoid forward reference issues
+// drops and HUD messages don't carry over to another level
+static void clear_drops_and_hud(void) {
+    while (drops.count > 0) remove_drop(drops.count - 1);
+    pool_clear(&hud_msgs);
+}
 
 // helper: clear an Item slot
 static void clear_item(Item *it) {
@@ -188,7 +207,7 @@ static void clear_item(Item *it) {
     it->type = ITEM_CARD;
     it->stack = 0;
     it->max_stack = 0;
-    it->tex = NULL;
+    it->sprite = (Sprite){0};
 }
 
 // helper: add item to inventory (simple first-fit stacking)
@@ -231,126 +250,170 @@ static void init_inventories() {
     for (int i = 0; i < OTHER_SLOTS; ++i) clear_item(&otherInv.slots[i]);
 }
 
-typedef struct {
-    char key[TOKEN_SIZE];
-    SDL_Texture* tex;
-} TextureCacheEntry;
-
-static TextureCacheEntry texture_cache[MAX_TEXTURE_CACHE];
-static int texture_cache_count = 0;
-static SDL_Texture* player_tex = NULL;
-static SDL_Texture* player_tex_up = NULL;
-static SDL_Texture* player_tex_right = NULL;
-static SDL_Texture* player_tex_left = NULL;
+// token registry: every token string ("00", "A", "C01", ...) is interned once into a
+// compact id; the map, sprite lookup and tile properties are plain arrays indexed by it
+#define TILE_NONE 0
+static char token_names[MAX_TOKENS][TOKEN_SIZE];
+static Sprite token_sprites[MAX_TOKENS];
+static uint8_t token_solid[MAX_TOKENS]; // tile property: blocks movement
+static int token_count = 1; // id 0 is TILE_NONE
 
 typedef enum { DIR_DOWN = 0, DIR_UP = 1, DIR_LEFT = 2, DIR_RIGHT = 3 } Direction;
 static Direction player_dir = DIR_DOWN;
-
-// fallback textures created at runtime when file is missing
-static SDL_Texture* fallback_tile = NULL;
-static SDL_Texture* fallback_entity = NULL;
-static SDL_Texture* fallback_player = NULL;
-static SDL_Texture* ui_slot_tex = NULL;
-static SDL_Texture* ui_card_placeholder = NULL;
-static SDL_Texture* ui_item_placeholder = NULL;
+static AnimSheet player_anim; // assets/player.anim, clips indexed by Direction
+static AnimState player_anim_state = ANIM_IDLE; // clip drawn last frame, and since when
+static double player_anim_since = 0.0;
+static double player_attack_at = -1e9; // sim_clock of the last swing
+// animation sheet per entity letter, built on first use
+static AnimSheet entity_anims[128];
+static uint8_t entity_anim_ready[128];
+
+// fallback sprites created at runtime when file is missing
+static Sprite fallback_tile;
+static Sprite fallback_entity;
+static Sprite fallback_player;
+static Sprite ui_slot;
+static Sprite ui_card_placeholder;
+static Sprite ui_item_placeholder;
 static TTF_Font* ui_font = NULL;
 
-// draw TTF text using the loaded `ui_font`, fallback to bitmap font when not available
-static void draw_text_ttf(int x, int y, const char *text, SDL_Color color) {
-    if (!ui_font) { draw_string_small(x, y, 3, color, text); return; }
-    SDL_Surface* surf = TTF_RenderText_Blended(ui_font, text, color);
-    if (!surf) return;
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surf);
-    SDL_FreeSurface(surf);
-    if (!tex) return;
-    int w=0,h=0; SDL_QueryTexture(tex, NULL, NULL, &w, &h);
-    SDL_Rect dst = { x, y, w, h };
-    SDL_RenderCopy(renderer, tex, NULL, &dst);
-    SDL_DestroyTexture(tex);
-}
-
-// simple NPC representation
-typedef struct {
-    char id; /* letter */
-    float x, y;
-    float width, height;
-    SDL_Texture* tex;
-    int hp;
-    int max_hp;
-    int hostile; /* 0 = neutral, 1 = hostile */
-    char drop_id[8];
-    int level_on_kill; /* how many levels to gain on kill */
-    char dialog[128];
-    float wander_timer;
-    float attack_cooldown;
-    float hit_timer;
-    float vx, vy;
-    float speed;
-} NPC;
-
-static NPC npcs[MAX_NPCS];
-static int npc_count = 0;
 static float player_hit_timer = 0.0f;
+static double sim_clock = 0.0; // simulated seconds so far; animations run on it (not game state)
+
+// make previous == current so nothing is interpolated across a teleport (level load, restart)
+static void snap_interpolation(void) {
+    player.prev_x = player.x; player.prev_y = player.y;
+    memcpy(npcs.prev_x, npcs.x, sizeof(float) * npcs.count);
+    memcpy(npcs.prev_y, npcs.y, sizeof(float) * npcs.count);
+}
+
+static float lerpf(float a, float b, float t) { return a + (b - a) * t; }
 
 // Damage popup
 typedef struct { float x,y; char txt[32]; float timer; } DmgPopup;
-static DmgPopup dmg_popups[16];
-static int dmg_popup_count = 0;
+static Pool dmg_popups; // DmgPopup, DMG_POPUP_MAX
 
 static void spawn_dmg_popup(float x, float y, const char *fmt, ...) {
-    if (dmg_popup_count >= (int)(sizeof(dmg_popups)/sizeof(dmg_popups[0]))) return;
+    int slot = pool_add_evicting(&dmg_popups, offsetof(DmgPopup, timer));
+    if (slot < 0) return;
     va_list ap; va_start(ap, fmt);
-    DmgPopup *p = &dmg_popups[dmg_popup_count++];
+    DmgPopup *p = pool_at(&dmg_popups, slot);
     vsnprintf(p->txt, sizeof(p->txt), fmt, ap);
     va_end(ap);
     p->x = x; p->y = y; p->timer = 0.9f;
 }
 
-// helper: check whether an NPC at position (nx,ny) with size w/h would collide with solid tiles
-static int npc_will_collide(float nx, float ny, float w, float h) {
-    int left = (int)(nx) / TILE_SIZE;
-    int right = (int)(nx + w - 1) / TILE_SIZE;
-    int top = (int)(ny) / TILE_SIZE;
-    int bottom = (int)(ny + h - 1) / TILE_SIZE;
-    if (left < 0 || right >= level_cols || top < 0 || bottom >= level_rows) return 1;
-    for (int rr = top; rr <= bottom; ++rr) {
-        for (int cc = left; cc <= right; ++cc) {
-            if (collision_map[rr][cc]) return 1;
+// distance field toward the player's tile over the resident chunks; hostiles steer along it
+static FlowField flow;
+
+// NPC AI job state: tick parameters plus, for the chase pass, the player and the near list
+typedef struct {
+    float dt, max_x, max_y;
+    float pcx, pcy;
+    const int* ids;
+} NpcAiJob;
+
+// an NPC hit the player; recorded by the job workers, applied by apply_npc_attacks
+typedef struct { int npc; int dmg; } NpcAttack;
+static NpcAttack* npc_attacks[JOBS_MAX_WORKERS];
+static int npc_attack_count[JOBS_MAX_WORKERS];
+static int npc_attack_cap[JOBS_MAX_WORKERS];
+
+// movement pass over NPCs [begin, end): timers, wandering, swept tile collision, damping
+static void npc_move_range(int begin, int end, int worker, void* ctx) {
+    const NpcAiJob* job = ctx;
+    (void)worker;
+    npc_tick_timers(begin, end, job->dt);
+    for (int i = begin; i < end; ++i) {
+        // wandering: pick a velocity occasionally and apply smooth motion
+        if (npcs.wander_timer[i] <= 0) {
+            float ang = ((float)(npc_rand(i) % 360)) * 3.14159f / 180.0f;
+            npcs.vx[i] = cosf(ang) * npcs.speed[i];
+            npcs.vy[i] = sinf(ang) * npcs.speed[i];
+            npcs.wander_timer[i] = 0.5f + (npc_rand(i)%100)/100.0f; // short bursts
         }
     }
-    return 0;
+    for (int i = begin; i < end; ++i) {
+        // move, sliding along walls; bounce off whatever stopped an axis
+        WorldMove m = world_move_and_slide(npcs.x[i], npcs.y[i], npcs.width[i], npcs.height[i], npcs.vx[i] * job->dt, npcs.vy[i] * job->dt);
+        npcs.x[i] = m.x; npcs.y[i] = m.y;
+        if (m.hit_x) npcs.vx[i] *= -0.5f;
+        if (m.hit_y) npcs.vy[i] *= -0.5f;
+    }
+    // damping, then clamp to level bounds
+    npc_damp_and_clamp(begin, end, 0.95f, job->max_x, job->max_y);
 }
 
-// apply options string (comma-separated) to an NPC (helper reused by load_level and meta loader)
-static void apply_options_to_npc(NPC *n, const char *opts_str) {
-    if (!n || !opts_str || !opts_str[0]) return;
-    char low[128]; size_t li = 0; for (const char *pp = opts_str; *pp && li < sizeof(low)-1; ++pp) low[li++] = (char)tolower((unsigned char)*pp); low[li]='\0';
-    int looks_like_opts = 0;
-    if (strstr(low, "hostile") || strstr(low, "say=") || strchr(opts_str, ',') || strchr(opts_str, '=')) looks_like_opts = 1;
-    if (!looks_like_opts) return;
-    char opts[256]; strncpy(opts, opts_str, sizeof(opts)-1); opts[sizeof(opts)-1] = '\0';
-    char *tok2 = strtok(opts, ",");
-    while (tok2) {
-        // trim
-        size_t p = strlen(tok2); while (p>0 && (unsigned char)tok2[p-1]<32) tok2[--p]='\0';
-        while (*tok2 && (unsigned char)*tok2<33) tok2++;
-        char lowtok[128]; size_t lli=0; for (const char *pp = tok2; *pp && lli < sizeof(lowtok)-1; ++pp) lowtok[lli++] = (char)tolower((unsigned char)*pp); lowtok[lli]='\0';
-        if (strstr(lowtok, "hostile") != NULL) { n->hostile = 1; }
-        else if (strstr(lowtok, "neutral") != NULL || strstr(lowtok, "friendly") != NULL) { n->hostile = 0; }
-        else if (strncasecmp(tok2, "hp=", 3) == 0) { n->hp = n->max_hp = atoi(tok2+3); }
-        else if (strncasecmp(tok2, "drop=", 5) == 0) { strncpy(n->drop_id, tok2+5, sizeof(n->drop_id)-1); n->drop_id[sizeof(n->drop_id)-1]='\0'; }
-        else if (strncasecmp(tok2, "lvl=", 4) == 0) { n->level_on_kill = atoi(tok2+4); }
-        else if (strncasecmp(tok2, "say=", 4) == 0) {
-            char *s = tok2+4;
-            if (*s == '"') { s++; size_t sl = strlen(s); if (sl>0 && s[sl-1]=='"') s[sl-1]='\0'; }
-            strncpy(n->dialog, s, sizeof(n->dialog)-1); n->dialog[sizeof(n->dialog)-1] = '\0';
+// chase pass over near list entries [begin, end): hostiles steer toward the player and attack
+static void npc_chase_range(int begin, int end, int worker, void* ctx) {
+    const NpcAiJob* job = ctx;
+    for (int k = begin; k < end; ++k) {
+        int i = job->ids[k];
+        if (!npcs.hostile[i]) continue;
+        float nx = npcs.x[i] + npcs.width[i]/2.0f; float ny = npcs.y[i] + npcs.height[i]/2.0f;
+        float dist = hypotf(nx-job->pcx, ny-job->pcy);
+        // follow the flow field around walls; straight at the player on the player's tile
+        // or where the field does not reach
+        float dirx, diry;
+        if (!flow_direction(&flow, nx, ny, &dirx, &diry)) {
+            dirx = (job->pcx - nx); diry = (job->pcy - ny);
+            float len = hypotf(dirx, diry); if (len > 0.001f) { dirx/=len; diry/=len; }
         }
-        tok2 = strtok(NULL, ",");
+        // apply to velocity so movement stays smooth and collidable
+        npcs.vx[i] += dirx * 40.0f * job->dt;
+        npcs.vy[i] += diry * 40.0f * job->dt;
+        // clamp speed
+        float sp = hypotf(npcs.vx[i], npcs.vy[i]); if (sp > 60.0f) { npcs.vx[i] = npcs.vx[i] / sp * 60.0f; npcs.vy[i] = npcs.vy[i] / sp * 60.0f; }
+        // attack if in melee range and cooldown elapsed
+        if (dist < 34.0f && npcs.attack_cooldown[i] <= 0) {
+            int dmg = NPC_BASE_DAMAGE + (npc_cold[i].level_on_kill);
+            // apply defense reduction
+            int reduced = (int)(dmg * (100 - player_defense_pct) / 100.0f);
+            if (npc_attack_count[worker] == npc_attack_cap[worker]) {
+                int cap = npc_attack_cap[worker] ? npc_attack_cap[worker] * 2 : 64;
+                NpcAttack* p = realloc(npc_attacks[worker], sizeof(NpcAttack) * (size_t)cap);
+                if (!p) continue;
+                npc_attacks[worker] = p; npc_attack_cap[worker] = cap;
+            }
+            npc_attacks[worker][npc_attack_count[worker]++] = (NpcAttack){ i, reduced };
+            npcs.attack_cooldown[i] = NPC_ATTACK_COOLDOWN;
+        }
+    }
+}
+
+static int cmp_npc_attack(const void* a, const void* b) {
+    return ((const NpcAttack*)a)->npc - ((const NpcAttack*)b)->npc;
+}
+
+// merge the workers' attack events and apply them in NPC order
+static void apply_npc_attacks(void) {
+    static NpcAttack* merged = NULL;
+    static int merged_cap = 0;
+    int total = 0;
+    for (int w = 0; w < jobs_worker_count(); ++w) total += npc_attack_count[w];
+    if (total == 0) return;
+    if (total > merged_cap) {
+        NpcAttack* p = realloc(merged, sizeof(NpcAttack) * (size_t)total);
+        if (!p) return;
+        merged = p; merged_cap = total;
+    }
+    int n = 0;
+    for (int w = 0; w < jobs_worker_count(); ++w) {
+        if (npc_attack_count[w] == 0) continue;
+        memcpy(merged + n, npc_attacks[w], sizeof(NpcAttack) * (size_t)npc_attack_count[w]);
+        n += npc_attack_count[w];
+    }
+    qsort(merged, (size_t)n, sizeof(NpcAttack), cmp_npc_attack);
+    for (int k = 0; k < n; ++k) {
+        player_hp -= merged[k].dmg;
+        // visual feedback
+        player_hit_timer = 0.35f;
+        spawn_dmg_popup(player.x + player.width/2, player.y, "-%d", merged[k].dmg);
     }
 }
 
-// helper: create a solid-color texture for a token and cache it
-static SDL_Texture* create_colored_texture_for_token(const char* token, int w, int h) {
+// helper: create a solid-color atlas sprite for a token (color derived from the token)
+static Sprite create_colored_sprite_for_token(const char* token, int w, int h) {
     // use simple hashing to derive a color from token
     unsigned int hash = 0;
     for (const char* p = token; *p; ++p) hash = (hash * 131) + (unsigned char)(*p);
@@ -358,12 +421,9 @@ static SDL_Texture* create_colored_texture_for_token(const char* token, int w, i
     Uint8 g = 40 + ((hash >> 8) & 0x7F);
     Uint8 b = 120 + ((hash >> 16) & 0x7F);
 
-    SDL_Surface* s = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
-    if (!s) return NULL;
-    SDL_FillRect(s, NULL, SDL_MapRGBA(s->format, r, g, b, 255));
-    SDL_Texture* t = SDL_CreateTextureFromSurface(renderer, s);
-    SDL_FreeSurface(s);
-    return t;
+    Sprite sp = {0};
+    atlas_add_color((SDL_Color){ r, g, b, 255 }, w, h, &sp);
+    return sp;
 }
 
 int initialize_window(void) {
@@ -390,329 +450,902 @@ int initialize_window(void) {
         fprintf(stderr, "Error creating SDL Window: %s\n", SDL_GetError());
         return FALSE;
     }
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    SDL_DisplayMode display;
+    int refresh = SDL_GetWindowDisplayMode(window, &display) == 0 && display.refresh_rate > 0 ? display.refresh_rate : PACING_DEFAULT_FPS;
+    pacing_init(pacing, pacing == PACING_CAPPED && pacing_fps > 0 ? pacing_fps : refresh);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (pacing_vsync() ? SDL_RENDERER_PRESENTVSYNC : 0));
     if (!renderer) {
         fprintf(stderr, "Error creating SDL Renderer: %s\n", SDL_GetError());
         return FALSE;
     }
-
-    last_frame_time = SDL_GetTicks();
+    // without vsync a present returns at once and the vsync modes would spin at 100% CPU
+    SDL_RendererInfo info;
+    if (pacing_vsync() && SDL_GetRendererInfo(renderer, &info) == 0 && !(info.flags & SDL_RENDERER_PRESENTVSYNC)) {
+        fprintf(stderr, "No vsync: pacing capped at %d fps\n", pacing_fps > 0 ? pacing_fps : refresh);
+        pacing_init(PACING_CAPPED, pacing_fps > 0 ? pacing_fps : refresh);
+    }
 
     return TRUE;
 }
 
-static SDL_Texture* cache_lookup(const char* key) {
-    for (int i = 0; i < texture_cache_count; ++i) {
-        if (strcmp(texture_cache[i].key, key) == 0) return texture_cache[i].tex;
+static Sprite load_sprite_file_for_token(const char* token);
+
+// registered token id, TILE_NONE if the token is unknown; the only place token strings are compared
+static uint16_t token_find(const char* token) {
+    if (!token || !token[0]) return TILE_NONE;
+    for (int i = 1; i < token_count; ++i) {
+        if (strcmp(token_names[i], token) == 0) return (uint16_t)i;
     }
-    return NULL;
+    return TILE_NONE;
 }
 
-static SDL_Texture* cache_insert(const char* key, SDL_Texture* tex) {
-    if (texture_cache_count >= MAX_TEXTURE_CACHE) return tex;
-    strncpy(texture_cache[texture_cache_count].key, key, TOKEN_SIZE - 1);
-    texture_cache[texture_cache_count].key[TOKEN_SIZE - 1] = '\0';
-    texture_cache[texture_cache_count].tex = tex;
-    texture_cache_count++;
-    return tex;
+// register a new token without a sprite; TILE_NONE when the registry is full
+static uint16_t token_add(const char* token) {
+    if (token_count >= MAX_TOKENS) {
+        fprintf(stderr, "Token registry full, ignoring '%s'\n", token);
+        return TILE_NONE;
+    }
+    uint16_t id = (uint16_t)token_count++;
+    strncpy(token_names[id], token, TOKEN_SIZE - 1);
+    token_names[id][TOKEN_SIZE - 1] = '\0';
+    token_solid[id] = (uint8_t)level_token_is_solid(token_names[id]);
+    return id;
 }
 
-static SDL_Texture* load_texture_for_token(const char* token) {
-    SDL_Texture* cached = cache_lookup(token);
-    if (cached) return cached;
+// look up (or register) a token, loading its image on first use
+static uint16_t token_intern(const char* token) {
+    if (!token || !token[0]) return TILE_NONE;
+    uint16_t id = token_find(token);
+    if (id != TILE_NONE) return id;
+    id = token_add(token);
+    if (id != TILE_NONE) token_sprites[id] = load_sprite_file_for_token(token_names[id]);
+    return id;
+}
 
-    char path[512];
+// image file and atlas size for a token: tiles fill a cell, entities use the NPC sprite size.
+// Pure, so the level loader thread can call it too.
+static void token_image_info(const char* token, char* path, size_t path_size, int* w, int* h) {
     if (isalpha((unsigned char)token[0])) {
-        snprintf(path, sizeof(path), "assets/entities/%c.png", token[0]);
+        snprintf(path, path_size, "assets/entities/%c.png", token[0]);
+        *w = 24 * ATLAS_SPRITE_SCALE; *h = 31 * ATLAS_SPRITE_SCALE;
     } else {
-        snprintf(path, sizeof(path), "assets/tiles/%s.png", token);
+        snprintf(path, path_size, "assets/tiles/%s.png", token);
+        *w = TILE_SIZE * ATLAS_SPRITE_SCALE; *h = TILE_SIZE * ATLAS_SPRITE_SCALE;
     }
+}
 
-    SDL_Texture* tex = IMG_LoadTexture(renderer, path);
-    if (!tex) {
+#ifndef GAME_NO_MAIN
+// register a token with an image the loader thread already decoded (NULL: it had none)
+static uint16_t token_intern_prepared(const char* token, SDL_Surface* prepared) {
+    uint16_t id = token_find(token);
+    if (id != TILE_NONE || !token[0]) return id;
+    id = token_add(token);
+    if (id == TILE_NONE) return id;
+    if (!renderer) return id;
+    if (!atlas_add_prepared(prepared, &token_sprites[id])) {
+        fprintf(stderr, "Failed to load texture for '%s'\n", token);
+        token_sprites[id] = create_colored_sprite_for_token(token, TILE_SIZE, TILE_SIZE);
+        return id;
+    }
+    // the file it came from, for hot reloading
+    char path[512];
+    int w, h;
+    token_image_info(token, path, sizeof(path), &w, &h);
+    atlas_track_file(path, &token_sprites[id]);
+    return id;
+}
+#endif
+
+// load the image for a token into the atlas (called once per token by token_intern)
+static Sprite load_sprite_file_for_token(const char* token) {
+    if (!renderer) return (Sprite){0}; // headless: simulation never touches textures
+    char path[512];
+    int w, h;
+    token_image_info(token, path, sizeof(path), &w, &h);
+    Sprite sp = {0};
+    if (!atlas_add_file(path, w, h, &sp)) {
         fprintf(stderr, "Failed to load texture '%s': %s\n", path, IMG_GetError());
         // generate a per-token colored fallback and cache it
-        int w = TILE_SIZE;
-        int h = TILE_SIZE;
-        if (isalpha((unsigned char)token[0])) {
-            // entity sized fallback
-            tex = create_colored_texture_for_token(token, w, h);
-        } else {
-            tex = create_colored_texture_for_token(token, w, h);
-        }
-        if (tex) cache_insert(token, tex);
-    } else {
-        cache_insert(token, tex);
+        sp = create_colored_sprite_for_token(token, TILE_SIZE, TILE_SIZE);
     }
-    return tex;
+    return sp;
 }
 
-int load_level(const char* path) {
-    FILE* f = fopen(path, "r");
-    if (!f) {
-        fprintf(stderr, "Failed to open level file '%s'\n", path);
-        return FALSE;
-    }
-    char line[1024];
-    int r = 0;
-    int max_cols = 0;
-    // reset npc list and collision map
-    npc_count = 0;
-    memset(collision_map, 0, sizeof(collision_map));
-
-    while (r < MAX_ROWS && fgets(line, sizeof(line), f)) {
-        char* p = strchr(line, '\n');
-        if (p) *p = '\0';
-        // skip markdown/code-fence lines if the level file was wrapped in fences
-        // trim leading whitespace
-        char *start = line; while (*start && (unsigned char)*start <= 32) start++;
-        if (start[0] == '`' && start[1] == '`' && start[2] == '`') continue;
-        int c = 0;
-        char *scan = line;
-        while (c < MAX_COLS) {
-            // skip whitespace
-            while (*scan && (*scan == ' ' || *scan == '\t')) scan++;
-            if (!*scan) break;
-            char tokenbuf[512]; int ti = 0;
-            int depth = 0; // parentheses depth
-            while (*scan) {
-                if ((*scan == ' ' || *scan == '\t') && depth == 0) break;
-                if (*scan == '(') { depth++; tokenbuf[ti++] = *scan++; continue; }
-                if (*scan == ')') { if (depth>0) { tokenbuf[ti++] = *scan++; depth--; break; } else { tokenbuf[ti++] = *scan++; break; } }
-                tokenbuf[ti++] = *scan++;
-                if (ti >= (int)sizeof(tokenbuf)-1) break;
-            }
-            tokenbuf[ti] = '\0';
-            char *token = tokenbuf;
-            // trim trailing control characters (e.g. '\r') from token
-            size_t tlen = strlen(token);
-            while (tlen > 0 && (unsigned char)token[tlen-1] < 32) {
-                token[--tlen] = '\0';
-            }
+static Sprite load_sprite_for_token(const char* token) {
+    return token_sprites[token_intern(token)];
+}
 
-            // support syntax like A(00) or P(00): core token before '(' and underlying tile inside
-            char core[64];
-            char under[TOKEN_SIZE] = "";
-            char opts_str[128] = ""; // full options string when present
-            strncpy(core, token, sizeof(core)-1);
-            core[sizeof(core)-1] = '\0';
-            char *lp = strchr(core, '(');
-            if (lp) {
-                char *rp = strchr(lp, ')');
-                if (rp && rp > lp+1) {
-                    size_t ilen = (size_t)(rp - lp - 1);
-                    char inner[128];
-                    if (ilen >= sizeof(inner)) ilen = sizeof(inner)-1;
-                    strncpy(inner, lp+1, ilen);
-                    inner[ilen] = '\0';
-                    // trim inner
-                    size_t inlen = strlen(inner);
-                    while (inlen > 0 && (unsigned char)inner[inlen-1] < 32) inner[--inlen] = '\0';
-                    // if inner starts with digits or looks like a simple tile id, treat as floor under token
-                    if (inlen > 0 && (isdigit((unsigned char)inner[0]) || (isalpha((unsigned char)inner[0]) && strlen(inner) <= 3))) {
-                        // take as under tile
-                        if (isdigit((unsigned char)inner[0])) {
-                            int v = atoi(inner);
-                            snprintf(under, TOKEN_SIZE, "%02d", v);
-                        } else {
-                            strncpy(under, inner, TOKEN_SIZE-1);
-                            under[TOKEN_SIZE-1] = '\0';
-                        }
-                    } else if (inlen > 0) {
-                        // treat as comma-separated options for NPCs: hostile, hp=##, drop=ID, lvl=#, say=...
-                        // store the full options string into opts_str (don't truncate)
-                        strncpy(opts_str, inner, sizeof(opts_str)-1);
-                        opts_str[sizeof(opts_str)-1] = '\0';
-                    }
-                    *lp = '\0';
-                }
-            }
+// (re)build an entity letter's animations in place: assets/entities/<L>.anim, else its one
+// sprite for every clip
+static void load_entity_anim(char id) {
+    int k = id & 127;
+    char et[2] = { id, '\0' }, path[512];
+    int w, h;
+    token_image_info(et, path, sizeof(path), &w, &h);
+    snprintf(path, sizeof(path), "assets/entities/%c.anim", id);
+    Sprite sp = load_sprite_for_token(et);
+    if (renderer) anim_load(&entity_anims[k], path, w, h, sp); // no file: sp for every clip
+    else anim_single(&entity_anims[k], sp);
+    entity_anim_ready[k] = 1;
+}
 
-            // trim core trailing control
-            size_t clen = strlen(core);
-            while (clen > 0 && (unsigned char)core[clen-1] < 32) core[--clen] = '\0';
+static const AnimSheet* entity_anim(char id) {
+    if (!entity_anim_ready[id & 127]) load_entity_anim(id);
+    return &entity_anims[id & 127];
+}
 
-            // normalize main/core token
-            char norm_main[TOKEN_SIZE];
-            if (clen > 0 && isdigit((unsigned char)core[0])) {
-                int v = atoi(core);
-                snprintf(norm_main, TOKEN_SIZE, "%02d", v);
-            } else {
-                strncpy(norm_main, core, TOKEN_SIZE-1);
-                norm_main[TOKEN_SIZE-1] = '\0';
-            }
+static void load_player_anim(void) {
+    int pw = (int)player.width * ATLAS_SPRITE_SCALE, ph = (int)player.height * ATLAS_SPRITE_SCALE;
+    if (!anim_load(&player_anim, "assets/player.anim", pw, ph, fallback_player))
+        fprintf(stderr, "Could not load player animations: %s\n", IMG_GetError());
+}
 
-            // determine the effective tile shown under this cell: use 'under' if provided, else if main is numeric use norm_main, otherwise default to "00"
-            char floor_token[TOKEN_SIZE];
-            if (under[0] != '\0') {
-                strncpy(floor_token, under, TOKEN_SIZE-1);
-            } else if (isdigit((unsigned char)norm_main[0])) {
-                strncpy(floor_token, norm_main, TOKEN_SIZE-1);
-            } else {
-                strncpy(floor_token, "00", TOKEN_SIZE-1);
-            }
-            floor_token[TOKEN_SIZE-1] = '\0';
+// pack every tile and entity image into the atlas up front so nothing is loaded mid-game
+static void preload_atlas_dir(const char* dir, int entities) {
+    DIR* d = opendir(dir);
+    if (!d) return;
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        const char* dot = strrchr(e->d_name, '.');
+        if (!dot || strcmp(dot, ".png") != 0) continue;
+        size_t klen = (size_t)(dot - e->d_name);
+        if (klen == 0 || klen >= TOKEN_SIZE) continue;
+        // entity sprites are keyed by their letter, tiles by their token (file name)
+        if (entities && klen != 1) continue;
+        char key[TOKEN_SIZE];
+        memcpy(key, e->d_name, klen); key[klen] = '\0';
+        token_intern(key);
+    }
+    closedir(d);
+}
 
-            // store floor token into level map
-            strncpy(level_tiles[r][c], floor_token, TOKEN_SIZE - 1);
-            level_tiles[r][c][TOKEN_SIZE - 1] = '\0';
+// prebaked static map: each resident world chunk renders its floor/wall layer into a
+// render-target texture; a chunk is re-baked only when it is (re)loaded
+static void bake_chunk(WorldChunk* ch) {
+    const int chunk_px = WORLD_CHUNK_TILES * TILE_SIZE;
+    const SDL_Color no_tint = { 255, 255, 255, 255 };
+    if (!ch->tex) {
+        ch->tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, chunk_px, chunk_px);
+        if (!ch->tex) { fprintf(stderr, "Could not create map chunk texture: %s\n", SDL_GetError()); return; }
+        SDL_SetTextureBlendMode(ch->tex, SDL_BLENDMODE_BLEND);
+    }
+    SDL_Texture* prev_target = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, ch->tex);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    batch_begin(renderer);
+    for (int r = 0; r < WORLD_CHUNK_TILES; ++r) {
+        for (int c = 0; c < WORLD_CHUNK_TILES; ++c) {
+            uint16_t id = ch->tiles[r * WORLD_CHUNK_TILES + c];
+            if (id == TILE_NONE) continue;
+            batch_sprite(&token_sprites[id], c * TILE_SIZE, r * TILE_SIZE, TILE_SIZE, TILE_SIZE, no_tint);
+        }
+    }
+    batch_flush();
+    SDL_SetRenderTarget(renderer, prev_target);
+    ch->dirty = 0;
+}
 
-            // handle player spawn if core indicates P
-            if ((core[0] == 'P' || core[0] == 'p')) {
-                player.x = c * TILE_SIZE + (TILE_SIZE - player.width) / 2.0f;
-                player.y = r * TILE_SIZE + (TILE_SIZE - player.height) / 2.0f;
-            }
+// fill a freshly spawned NPC's fixed data (cold data, size, speed, side) from level spawn record k
+static void npc_from_spawn(int i, int k) {
+    const LevelData* lv = &current_level;
+    const LevelNpcSpawn* s = &lv->npcs[k];
+    NpcCold *n = &npc_cold[i];
+    n->id = s->id;
+    n->spawn = k;
+    npcs.width[i] = 24;
+    npcs.height[i] = 31;
+    n->anim = entity_anim(s->id);
+    n->max_hp = s->max_hp;
+    npcs.hostile[i] = s->hostile;
+    memcpy(n->drop_id, s->drop_id, sizeof(n->drop_id)); n->drop_id[sizeof(n->drop_id)-1] = '\0';
+    n->level_on_kill = s->level_on_kill;
+    strncpy(n->dialog, level_string(lv, s->dialog), sizeof(n->dialog)-1); n->dialog[sizeof(n->dialog)-1] = '\0';
+    npcs.speed[i] = 20.0f;
+}
 
-            // detect NPC (letter) based on core, but skip 'P' which is player
-            if (isalpha((unsigned char)core[0]) && !(core[0] == 'P' || core[0] == 'p')) {
-                if (npc_count < (int)(sizeof(npcs)/sizeof(npcs[0]))) {
-                    NPC *n = &npcs[npc_count++];
-                    n->id = core[0];
-                    n->x = c * TILE_SIZE;
-                    n->y = r * TILE_SIZE;
-                    n->width = 24;
-                    n->height = 31;
-                    // use a clean single-char key when loading entity texture
-                    char et[2] = { core[0], '\0' };
-                    n->tex = load_texture_for_token(et);
-                    // defaults
-                    n->max_hp = 10;
-                    n->hp = n->max_hp;
-                    n->hostile = 0;
-                    n->drop_id[0] = '\0';
-                    n->level_on_kill = 1;
-                    n->dialog[0] = '\0';
-                    n->wander_timer = 0.0f;
-                    n->attack_cooldown = 0.0f;
-                    n->vx = 0.0f; n->vy = 0.0f; n->speed = 20.0f;
-                    // if opts_str contains data treat as options string (full, not truncated)
-                    if (opts_str[0] != '\0') {
-                        char low[128]; size_t li = 0; for (const char *pp = opts_str; *pp && li < sizeof(low)-1; ++pp) low[li++] = (char)tolower((unsigned char)*pp); low[li]='\0';
-                        int looks_like_opts = 0;
-                        if (strstr(low, "hostile") || strstr(low, "say=") || strchr(opts_str, ',') || strchr(opts_str, '=')) looks_like_opts = 1;
-                        if (looks_like_opts) {
-                            char opts[128]; strncpy(opts, opts_str, sizeof(opts)-1); opts[sizeof(opts)-1] = '\0';
-                            char *tok2 = strtok(opts, ",");
-                            while (tok2) {
-                                // trim
-                                size_t p = strlen(tok2); while (p>0 && (unsigned char)tok2[p-1]<32) tok2[--p]='\0';
-                                while (*tok2 && (unsigned char)*tok2<33) tok2++;
-                                // robust detection: check lowercase substring
-                                char lowtok[128]; size_t lli=0; for (const char *pp = tok2; *pp && lli < sizeof(lowtok)-1; ++pp) lowtok[lli++] = (char)tolower((unsigned char)*pp); lowtok[lli]='\0';
-                                if (strstr(lowtok, "hostile") != NULL) { n->hostile = 1; }
-                                else if (strncasecmp(tok2, "hp=", 3) == 0) { n->hp = n->max_hp = atoi(tok2+3); }
-                                else if (strncasecmp(tok2, "drop=", 5) == 0) { strncpy(n->drop_id, tok2+5, sizeof(n->drop_id)-1); n->drop_id[sizeof(n->drop_id)-1]='\0'; }
-                                else if (strncasecmp(tok2, "lvl=", 4) == 0) { n->level_on_kill = atoi(tok2+4); }
-                                else if (strncasecmp(tok2, "say=", 4) == 0) {
-                                    char *s = tok2+4;
-                                    if (*s == '"') { s++; size_t sl = strlen(s); if (sl>0 && s[sl-1]=='"') s[sl-1]='\0'; }
-                                    strncpy(n->dialog, s, sizeof(n->dialog)-1);
-                                    n->dialog[sizeof(n->dialog)-1] = '\0';
-                                }
-                                tok2 = strtok(NULL, ",");
-                            }
-                        }
-                    }
-                }
-            }
+// bring spawn record k into the NPC store where it was last seen; FALSE at the NPC limit
+static int spawn_from_record(int k) {
+    WorldSpawn* ws = &world.spawns[k];
+    int i = npc_spawn();
+    if (i < 0) return FALSE;
+    npc_from_spawn(i, k);
+    npcs.x[i] = npcs.prev_x[i] = ws->x;
+    npcs.y[i] = npcs.prev_y[i] = ws->y;
+    npcs.hp[i] = ws->hp;
+    ws->active = 1;
+    return TRUE;
+}
 
-            // collision: check floor_token (normalized)
-            if (isdigit((unsigned char)floor_token[0])) {
-                if (strcmp(floor_token, "01") == 0 || strcmp(floor_token, "02") == 0||strcmp(floor_token, "04") == 0){
-                    collision_map[r][c] = 1;
-                }
-            }
+// a chunk came into range: bake its static light and spawn the NPCs last seen in it
+static void on_chunk_load(int slot) {
+    const WorldChunk* ch = &world.slots[slot];
+    light_bake_chunk(slot);
+    for (int k = world.spawn_head[ch->cr * world.chunk_cols + ch->cc]; k >= 0; k = world.spawns[k].next) {
+        WorldSpawn* ws = &world.spawns[k];
+        if (!ws->alive || ws->active) continue;
+        if (!spawn_from_record(k)) break;
+    }
+}
 
-            c++;
-        }
-        if (c > max_cols) max_cols = c;
-        r++;
-    }
-    fclose(f);
-    level_rows = r;
-    level_cols = max_cols;
-    for (int i = 0; i < npc_count; ++i) {
-        int tr = (int)(npcs[i].y) / TILE_SIZE;
-        int tc = (int)(npcs[i].x) / TILE_SIZE;
-        if (tr >= 0 && tr < MAX_ROWS && tc >= 0 && tc < MAX_COLS) {
-            strncpy(level_tiles[tr][tc], "00", TOKEN_SIZE - 1);
-            level_tiles[tr][tc][TOKEN_SIZE - 1] = '\0';
+// a chunk left range: NPCs standing in it write their state back and despawn
+static void on_chunk_evict(int slot) {
+    const WorldChunk* ch = &world.slots[slot];
+    int chunk = ch->cr * world.chunk_cols + ch->cc;
+    // walk backwards so swap-and-pop only moves NPCs that were already visited
+    for (int i = npcs.count - 1; i >= 0; --i) {
+        if (world_chunk_at(npcs.x[i] + npcs.width[i]/2.0f, npcs.y[i] + npcs.height[i]/2.0f) != chunk) continue;
+        int k = npc_cold[i].spawn;
+        if (k >= 0) {
+            WorldSpawn* ws = &world.spawns[k];
+            ws->x = npcs.x[i]; ws->y = npcs.y[i]; ws->hp = npcs.hp[i];
+            ws->active = 0;
+            world_spawn_relink(k, chunk);
         }
+        npc_remove(i);
+    }
+}
+
+// cover exactly the resident chunks with the proximity grids and the flow field, and refill
+// the grids
+static void reset_resident_grids(void) {
+    float ox = (float)(world.cc0 * WORLD_CHUNK_TILES * TILE_SIZE), oy = (float)(world.cr0 * WORLD_CHUNK_TILES * TILE_SIZE);
+    int rows = (world.cr1 - world.cr0 + 1) * WORLD_CHUNK_TILES, cols = (world.cc1 - world.cc0 + 1) * WORLD_CHUNK_TILES;
+    spatial_reserve(&npc_grid, npcs.capacity);
+    spatial_reset(&npc_grid, ox, oy, rows, cols);
+    spatial_reset(&drop_grid, ox, oy, rows, cols);
+    flow_reset(&flow, world.cr0 * WORLD_CHUNK_TILES, world.cc0 * WORLD_CHUNK_TILES, rows, cols);
+    for (int i = 0; i < npcs.count; ++i) spatial_insert(&npc_grid, i, npcs.x[i] + npcs.width[i]/2.0f, npcs.y[i] + npcs.height[i]/2.0f);
+    for (int i = 0; i < drops.count; ++i) { const Drop* d = pool_at(&drops, i); spatial_insert(&drop_grid, i, d->x, d->y); }
+}
+
+// chunk the resident window is centered on: the player's
+static void player_chunk(int* cr, int* cc) {
+    *cr = (int)((player.y + player.height/2.0f) / TILE_SIZE) / WORLD_CHUNK_TILES;
+    *cc = (int)((player.x + player.width/2.0f) / TILE_SIZE) / WORLD_CHUNK_TILES;
+}
+
+// re-center the resident window on the player's chunk; when it moves, the proximity grids
+// are rebuilt to cover exactly the resident chunks
+static void update_residency(void) {
+    int cr, cc;
+    player_chunk(&cr, &cc);
+    if (world_set_center(cr, cc, on_chunk_evict, on_chunk_load)) reset_resident_grids();
+}
+
+// file token index -> runtime tile id (one intern per distinct token, not per cell)
+static const uint16_t* level_remap(const LevelData* lv) {
+    static uint16_t remap[1 << 16];
+    remap[0] = TILE_NONE;
+    for (int i = 1; i < lv->token_count; ++i) remap[i] = token_intern(lv->tokens[i]);
+    return remap;
+}
+
+// install a parsed or mapped level: the world window around the player and its NPCs
+static int level_apply(void) {
+    const LevelData* lv = &current_level;
+    npc_clear();
+    level_rows = lv->rows;
+    level_cols = lv->cols;
+    if (!world_init(lv, level_remap(lv), residency_radius)) return FALSE;
+    // nothing draws the light map without a renderer
+    light_set_level(renderer ? lv : NULL);
+
+    if (lv->player_row >= 0) {
+        player.x = lv->player_col * TILE_SIZE + (TILE_SIZE - player.width) / 2.0f;
+        player.y = lv->player_row * TILE_SIZE + (TILE_SIZE - player.height) / 2.0f;
     }
-    // Debug: print parsed NPCs for diagnostics
-    for (int i = 0; i < npc_count; ++i) {
-        NPC *n = &npcs[i];
+    update_residency();
+    return TRUE;
+}
+
+// print the parsed map, NPCs and player (--debug-level)
+static void dump_level(void) {
+    for (int i = 0; i < npcs.count; ++i) {
+        NpcCold *n = &npc_cold[i];
         fprintf(stdout, "NPC parsed: id=%c pos=(%d,%d) hostile=%d hp=%d drop=%s lvl=%d dialog=%s\n",
-                n->id, (int)n->x/TILE_SIZE, (int)n->y/TILE_SIZE, n->hostile, n->hp, n->drop_id, n->level_on_kill, n->dialog);
-    }
-
-    // try to read a sidecar meta file for the level (e.g. levels/level1.meta)
-    char meta_path[260]; strncpy(meta_path, path, sizeof(meta_path)-6); meta_path[sizeof(meta_path)-1] = '\0';
-    size_t plen = strlen(path);
-    if (plen > 4) {
-        snprintf(meta_path, sizeof(meta_path), "%s.meta", path);
-        FILE *mf = fopen(meta_path, "r");
-        if (mf) {
-            char mline[256];
-            while (fgets(mline, sizeof(mline), mf)) {
-                // skip comments and blank
-                char *s = mline; while (*s && (unsigned char)*s <= 32) s++;
-                if (*s == '\0' || *s == '#') continue;
-                // expected format: x,y: OPTIONS
-                int mx=0,my=0; char *colon = strchr(s, ':');
-                if (!colon) continue;
-                *colon = '\0';
-                if (sscanf(s, "%d,%d", &my, &mx) != 2) continue;
-                char *opts = colon+1; while (*opts && (unsigned char)*opts <= 32) opts++;
-                // find NPC at tile (mx,my)
-                for (int i = 0; i < npc_count; ++i) {
-                    NPC *n = &npcs[i];
-                    int tr = (int)(n->y) / TILE_SIZE; int tc = (int)(n->x) / TILE_SIZE;
-                    if (tr == my && tc == mx) {
-                        apply_options_to_npc(n, opts);
-                        break;
-                    }
-                }
-            }
-            fclose(mf);
+                n->id, (int)npcs.x[i]/TILE_SIZE, (int)npcs.y[i]/TILE_SIZE, npcs.hostile[i], npcs.hp[i], n->drop_id, n->level_on_kill, n->dialog);
+    }
+    // resident part of the map only
+    for (int rr = world.cr0 * WORLD_CHUNK_TILES; rr < level_rows && rr < (world.cr1 + 1) * WORLD_CHUNK_TILES; ++rr) {
+        int c0 = world.cc0 * WORLD_CHUNK_TILES, c1 = (world.cc1 + 1) * WORLD_CHUNK_TILES;
+        if (c1 > level_cols) c1 = level_cols;
+        for (int cc = c0; cc < c1; ++cc) {
+            fprintf(stdout, "%s", token_names[world_tile(rr, cc)]);
+            if (cc < c1-1) fprintf(stdout, " ");
         }
+        fprintf(stdout, "\n");
     }
-    // player
     int ptr = (int)(player.y) / TILE_SIZE;
     int ptc = (int)(player.x) / TILE_SIZE;
-    if (ptr >= 0 && ptr < MAX_ROWS && ptc >= 0 && ptc < MAX_COLS) {
-        strncpy(level_tiles[ptr][ptc], "00", TOKEN_SIZE - 1);
-        level_tiles[ptr][ptc][TOKEN_SIZE - 1] = '\0';
-    }
-
-    for (int rr = 0; rr < level_rows; ++rr) {
-        for (int cc = 0; cc < level_cols; ++cc) {
-            char tok[TOKEN_SIZE];
-            strncpy(tok, level_tiles[rr][cc], TOKEN_SIZE-1);
-            tok[TOKEN_SIZE-1] = '\0';
-            fprintf(stdout, "%s", tok);
-            if (cc < level_cols-1) fprintf(stdout, " ");
-        }
-        fprintf(stdout, "\n");
+    if (ptr >= 0 && ptr < level_rows && ptc >= 0 && ptc < level_cols) {
+        fprintf(stdout, "Player at %d,%d token=%s\n", ptr, ptc, token_names[world_tile(ptr, ptc)]);
+    }
+}
+
+static void save_level_start(void);
+
+// make a loaded level (read from path) the current one (takes ownership of lv)
+static int install_level(LevelData lv, const char* path) {
+    // chunks and spawns of the old level point into its data: drop them before freeing it
+    world_free();
+    level_free(&current_level);
+    current_level = lv;
+    snprintf(level_path, sizeof(level_path), "%s", path);
+    if (!level_apply()) {
+        fprintf(stderr, "Out of memory installing level\n");
+        return FALSE;
+    }
+    if (level_debug) dump_level();
+    snap_interpolation();
+    return TRUE;
+}
+
+int load_level(const char* path) {
+    LevelData lv;
+    if (!level_load(path, &lv)) {
+        fprintf(stderr, "Failed to open level file '%s'\n", path);
+        return FALSE;
+    }
+    return install_level(lv, path);
+}
+
+// start loading a level in the background; poll_level_loader() swaps it in when it is ready
+static int request_level(const char* path) {
+    if (loader_status() != LOADER_IDLE) return FALSE;
+    snprintf(requested_level, sizeof(requested_level), "%s", path);
+    return loader_start(path, (const char (*)[TOKEN_SIZE])token_names, token_count, renderer ? token_image_info : NULL);
+}
+
+static int loader_uploaded = 0; // images of the finished load already in the atlas
+
+// drop a background load that has not been swapped in (the state it was started from is gone)
+static void cancel_level_load(void) {
+    if (loader_status() == LOADER_IDLE) return;
+    loader_finish();
+    loader_uploaded = 0;
+}
+
+#ifndef GAME_NO_MAIN
+// called once per frame (headless: per tick) between simulation ticks. Uploads at most
+// LOADER_UPLOADS_PER_FRAME decoded images, then switches to the new level. TRUE once a load
+// has finished (swapped in or failed).
+static int poll_level_loader(void) {
+    int status = loader_status();
+    if (status == LOADER_FAILED) {
+        add_hud_message("No next level found");
+        loader_finish();
+        return TRUE;
+    }
+    if (status != LOADER_READY) return FALSE;
+    int count = 0;
+    LoaderImage* images = loader_images(&count);
+    for (int n = 0; loader_uploaded < count && n < LOADER_UPLOADS_PER_FRAME; ++loader_uploaded, ++n) {
+        token_intern_prepared(images[loader_uploaded].token, images[loader_uploaded].surface);
+        SDL_FreeSurface(images[loader_uploaded].surface);
+        images[loader_uploaded].surface = NULL;
+    }
+    if (loader_uploaded < count) return FALSE;
+    // reset drops and hud when moving to next level
+    clear_drops_and_hud();
+    if (install_level(loader_take_level(), requested_level)) save_level_start();
+    loader_finish();
+    loader_uploaded = 0;
+    return TRUE;
+}
+
+// replay: the recorded session swapped levels right before this tick, so finish the load now
+// however long it takes, instead of whenever the loader thread happens to be done
+static void finish_level_load(void) {
+    while (loader_status() == LOADER_RUNNING) SDL_Delay(1);
+    while (loader_status() != LOADER_IDLE) poll_level_loader();
+}
+#endif
+
+// --- Snapshots ---
+// The simulation state is written section by section: player, inventories, drops, the level's
+// spawn records and the NPCs. Everything else is rebuilt on restore: the resident chunks and
+// their light from the level, the proximity grids and flow field from the positions, NPC cold
+// data from their spawn records, sprites from token ids. HUD messages and popups stay as
+// they are.
+typedef struct {
+    float x, y, hit_timer;
+    int32_t dir, level, max_hp, hp, defense_pct, game_over;
+} SnapPlayer;
+typedef struct { char id[8]; int32_t type, stack, max_stack; } SnapItem;
+typedef struct { char id[8]; float x, y; int32_t stack; } SnapDrop;
+// cold data of an NPC that has no spawn record to rebuild it from
+typedef struct { char id, drop_id[8]; int32_t max_hp, level_on_kill; } SnapNpcCold;
+// per-NPC bytes of the NPC section (spawn record, 10 floats, hp, side, rng)
+#define SNAP_NPC_BYTES (sizeof(int) + 10 * sizeof(float) + sizeof(int) + sizeof(uint8_t) + sizeof(uint32_t))
+
+static SnapshotRing rewind_ring; // one snapshot per tick, taken before it (R rewinds)
+static int rewinding = 0; // R is held
+static Snapshot level_start; // state right after the current level was set up (restart)
+static Snapshot quick_save;
+
+static void put_items(Snapshot* s, const Item* items, int count) {
+    for (int i = 0; i < count; ++i) {
+        SnapItem it;
+        memset(&it, 0, sizeof(it));
+        memcpy(it.id, items[i].id, sizeof(it.id));
+        it.type = items[i].type; it.stack = items[i].stack; it.max_stack = items[i].max_stack;
+        snapshot_put(s, &it, sizeof(it));
+    }
+}
+
+static int get_items(Snapshot* s, Item* items, int count) {
+    for (int i = 0; i < count; ++i) {
+        SnapItem it;
+        if (!snapshot_get(s, &it, sizeof(it))) return FALSE;
+        clear_item(&items[i]);
+        memcpy(items[i].id, it.id, sizeof(it.id)); items[i].id[sizeof(items[i].id)-1] = '\0';
+        items[i].type = (ItemType)it.type; items[i].stack = it.stack; items[i].max_stack = it.max_stack;
+        if (items[i].id[0]) items[i].sprite = load_sprite_for_token(items[i].id);
+    }
+    return TRUE;
+}
+
+// one NPC field array out of / into the store
+#define SNAP_PUT_NPCS(s, field) snapshot_put((s), npcs.field, sizeof(*npcs.field) * (size_t)npcs.count)
+#define SNAP_GET_NPCS(s, field) snapshot_get((s), npcs.field, sizeof(*npcs.field) * (size_t)npcs.count)
+
+static int save_state(Snapshot* s) {
+    if (!s) return FALSE;
+    snapshot_begin(s, level_path);
+    SnapPlayer p = { player.x, player.y, player_hit_timer, player_dir, player_level, player_max_hp, player_hp, player_defense_pct, game_over };
+    snapshot_put(s, &p, sizeof(p));
+    put_items(s, cardInv.slots, CARD_SLOTS);
+    put_items(s, otherInv.slots, OTHER_SLOTS);
+
+    int32_t n = drops.count;
+    snapshot_put(s, &n, sizeof(n));
+    for (int i = 0; i < drops.count; ++i) {
+        const Drop* d = pool_at(&drops, i);
+        SnapDrop sd;
+        memset(&sd, 0, sizeof(sd));
+        memcpy(sd.id, d->id, sizeof(sd.id));
+        sd.x = d->x; sd.y = d->y; sd.stack = d->stack;
+        snapshot_put(s, &sd, sizeof(sd));
+    }
+
+    // spawn records of the whole level, with the per-chunk lists they are linked into
+    int32_t w[3] = { world.hostiles_alive, current_level.npc_count, world.chunk_rows * world.chunk_cols };
+    snapshot_put(s, w, sizeof(w));
+    snapshot_put(s, world.spawns, sizeof(WorldSpawn) * (size_t)w[1]);
+    snapshot_put(s, world.spawn_head, sizeof(int) * (size_t)w[2]);
+
+    // NPCs in slot order, so they tick in the same order after a restore
+    int32_t cold = 0;
+    for (int i = 0; i < npcs.count; ++i) { npcs.scratch[i] = npc_cold[i].spawn; cold += npcs.scratch[i] < 0; }
+    uint32_t seed = npc_seed_state();
+    int32_t counts[2] = { npcs.count, cold };
+    snapshot_put(s, &seed, sizeof(seed));
+    snapshot_put(s, counts, sizeof(counts));
+    SNAP_PUT_NPCS(s, scratch);
+    SNAP_PUT_NPCS(s, x); SNAP_PUT_NPCS(s, y); SNAP_PUT_NPCS(s, vx); SNAP_PUT_NPCS(s, vy);
+    SNAP_PUT_NPCS(s, width); SNAP_PUT_NPCS(s, height); SNAP_PUT_NPCS(s, speed);
+    SNAP_PUT_NPCS(s, wander_timer); SNAP_PUT_NPCS(s, attack_cooldown); SNAP_PUT_NPCS(s, hit_timer);
+    SNAP_PUT_NPCS(s, hp); SNAP_PUT_NPCS(s, hostile); SNAP_PUT_NPCS(s, rng);
+    for (int i = 0; i < npcs.count && cold > 0; ++i) {
+        const NpcCold* c = &npc_cold[i];
+        if (c->spawn >= 0) continue;
+        SnapNpcCold sc;
+        memset(&sc, 0, sizeof(sc));
+        sc.id = c->id; memcpy(sc.drop_id, c->drop_id, sizeof(sc.drop_id));
+        sc.max_hp = c->max_hp; sc.level_on_kill = c->level_on_kill;
+        snapshot_put(s, &sc, sizeof(sc));
+    }
+    return snapshot_end(s);
+}
+
+// spawn records and list heads of a snapshot being restored, read and checked before any of
+// the game's state is touched (the buffers keep their memory, like the snapshots)
+static WorldSpawn* restore_spawns;
+static int* restore_heads;
+static int restore_spawn_cap, restore_head_cap;
+
+static int grow_restore_buffers(int spawns, int heads) {
+    if (spawns > restore_spawn_cap) {
+        WorldSpawn* p = realloc(restore_spawns, sizeof(WorldSpawn) * (size_t)spawns);
+        if (!p) return FALSE;
+        restore_spawns = p; restore_spawn_cap = spawns;
+    }
+    if (heads > restore_head_cap) {
+        int* p = realloc(restore_heads, sizeof(int) * (size_t)heads);
+        if (!p) return FALSE;
+        restore_heads = p; restore_head_cap = heads;
     }
-    for (int i = 0; i < npc_count; ++i) {
-        int tr = (int)(npcs[i].y) / TILE_SIZE;
-        int tc = (int)(npcs[i].x) / TILE_SIZE;
-        if (tr >= 0 && tr < level_rows && tc >= 0 && tc < level_cols) {
-            fprintf(stdout, "NPC %c at %d,%d token=%s\n", npcs[i].id, tr, tc, level_tiles[tr][tc]);
+    return TRUE;
+}
+
+// read the world and NPC sections of a snapshot and check them against the level lv they
+// will be restored on. The spawn records end up in restore_spawns/restore_heads and the NPCs'
+// spawn indices in npcs.scratch (room for the NPCs is reserved here); s is left at the NPC
+// arrays
+static int read_world_sections(Snapshot* s, const LevelData* lv, int32_t w[3], uint32_t* seed, int32_t counts[2]) {
+    int chunks = world_chunk_count(lv->rows, lv->cols);
+    if (!snapshot_get(s, w, sizeof(int32_t) * 3) || w[0] < 0 || w[1] != lv->npc_count || w[2] != chunks) return FALSE;
+    if (!grow_restore_buffers(w[1], w[2])) return FALSE;
+    if (!snapshot_get(s, restore_spawns, sizeof(WorldSpawn) * (size_t)w[1]) || !snapshot_get(s, restore_heads, sizeof(int) * (size_t)w[2])) return FALSE;
+    if (!world_spawns_valid(restore_spawns, w[1], restore_heads, w[2])) return FALSE;
+    if (!snapshot_get(s, seed, sizeof(*seed)) || !snapshot_get(s, counts, sizeof(int32_t) * 2)) return FALSE;
+    if (counts[0] < 0 || counts[1] < 0 || counts[1] > counts[0] || counts[0] > npcs.limit) return FALSE;
+    if (snapshot_remaining(s) != SNAP_NPC_BYTES * (size_t)counts[0] + sizeof(SnapNpcCold) * (size_t)counts[1]) return FALSE;
+    // room for the snapshot's NPCs before anything is cleared, so their spawn cannot fail
+    if (!npc_reserve(counts[0])) return FALSE;
+    // every NPC names a record of this level or is one of the counts[1] without one
+    size_t npcs_at = s->pos;
+    snapshot_get(s, npcs.scratch, sizeof(int) * (size_t)counts[0]);
+    s->pos = npcs_at;
+    int cold = 0;
+    for (int i = 0; i < counts[0]; ++i) {
+        if (npcs.scratch[i] < -1 || npcs.scratch[i] >= w[1]) return FALSE;
+        cold += npcs.scratch[i] == -1;
+    }
+    return cold == counts[1];
+}
+
+static void rebase_level_start(void);
+
+// put the game back into a snapshot's state, loading its level first if another one is
+// current. Every section is checked against the snapshot's level before anything changes;
+// FALSE leaves the game as it was unless that level could not be installed.
+static int restore_state(Snapshot* s) {
+    if (!s || !snapshot_open(s)) return FALSE;
+    SnapPlayer p;
+    Item cards[CARD_SLOTS], others[OTHER_SLOTS];
+    int32_t n;
+    if (!snapshot_get(s, &p, sizeof(p)) || p.dir < DIR_DOWN || p.dir > DIR_RIGHT) return FALSE;
+    if (!get_items(s, cards, CARD_SLOTS) || !get_items(s, others, OTHER_SLOTS)) return FALSE;
+    if (!snapshot_get(s, &n, sizeof(n)) || n < 0 || n > MAX_DROPS || snapshot_remaining(s) < sizeof(SnapDrop) * (size_t)n) return FALSE;
+    size_t drops_at = s->pos;
+    s->pos += sizeof(SnapDrop) * (size_t)n;
+
+    // a state of another level is checked against that level, read but not installed yet
+    const char* level = snapshot_header(s)->level;
+    int other_level = strcmp(level, level_path) != 0;
+    LevelData lv;
+    if (other_level && !level_load(level, &lv)) return FALSE;
+    int32_t w[3];
+    uint32_t seed;
+    int32_t counts[2];
+    if (!read_world_sections(s, other_level ? &lv : &current_level, w, &seed, counts)) {
+        if (other_level) level_free(&lv);
+        return FALSE;
+    }
+    size_t npcs_at = s->pos;
+
+    cancel_level_load();
+    if (other_level) {
+        clear_drops_and_hud();
+        if (!install_level(lv, level)) return FALSE;
+        // restarting goes back to the start of this level, not to the state loaded into it
+        rebase_level_start();
+    }
+
+    // everything fits: replace the state
+    player.x = p.x; player.y = p.y; player_hit_timer = p.hit_timer; player_dir = (Direction)p.dir;
+    player_level = p.level; player_max_hp = p.max_hp; player_hp = p.hp; player_defense_pct = p.defense_pct; game_over = p.game_over;
+    memcpy(cardInv.slots, cards, sizeof(cards));
+    memcpy(otherInv.slots, others, sizeof(others));
+
+    // NPCs are removed without writing back to their spawn records, which are replaced next
+    int live = npcs.count;
+    npc_clear();
+    world.hostiles_alive = w[0];
+    memcpy(world.spawns, restore_spawns, sizeof(WorldSpawn) * (size_t)w[1]);
+    memcpy(world.spawn_head, restore_heads, sizeof(int) * (size_t)w[2]);
+    // the resident window around the player; no NPC spawns here, they come from the snapshot
+    int cr, cc;
+    player_chunk(&cr, &cc);
+    world_set_center(cr, cc, NULL, light_bake_chunk);
+
+    s->pos = npcs_at;
+    npc_spawn_block(counts[0]);
+    SNAP_GET_NPCS(s, scratch);
+    SNAP_GET_NPCS(s, x); SNAP_GET_NPCS(s, y); SNAP_GET_NPCS(s, vx); SNAP_GET_NPCS(s, vy);
+    SNAP_GET_NPCS(s, width); SNAP_GET_NPCS(s, height); SNAP_GET_NPCS(s, speed);
+    SNAP_GET_NPCS(s, wander_timer); SNAP_GET_NPCS(s, attack_cooldown); SNAP_GET_NPCS(s, hit_timer);
+    SNAP_GET_NPCS(s, hp); SNAP_GET_NPCS(s, hostile); SNAP_GET_NPCS(s, rng);
+    for (int i = 0; i < npcs.count; ++i) {
+        NpcCold* c = &npc_cold[i];
+        int k = npcs.scratch[i];
+        // stepping back a tick mostly finds each NPC in the slot it already had: its cold data
+        // is still there
+        if (k >= 0 && i < live && c->spawn == k) continue;
+        if (k >= 0 && k < current_level.npc_count) {
+            // the record's fixed data, but the snapshot's (possibly moved on) hot fields
+            float wd = npcs.width[i], ht = npcs.height[i], sp = npcs.speed[i];
+            uint8_t side = npcs.hostile[i];
+            npc_from_spawn(i, k);
+            npcs.width[i] = wd; npcs.height[i] = ht; npcs.speed[i] = sp; npcs.hostile[i] = side;
+            continue;
         }
+        SnapNpcCold sc;
+        snapshot_get(s, &sc, sizeof(sc));
+        c->anim = entity_anim(sc.id);
+        c->spawn = -1;
+        c->id = sc.id;
+        memcpy(c->drop_id, sc.drop_id, sizeof(c->drop_id)); c->drop_id[sizeof(c->drop_id)-1] = '\0';
+        c->max_hp = sc.max_hp; c->level_on_kill = sc.level_on_kill;
+        c->dialog[0] = '\0';
     }
-    if (ptr >= 0 && ptr < level_rows && ptc >= 0 && ptc < level_cols) {
-        fprintf(stdout, "Player at %d,%d token=%s\n", ptr, ptc, level_tiles[ptr][ptc]);
+    npc_seed(seed);
+
+    while (drops.count > 0) remove_drop(drops.count - 1);
+    s->pos = drops_at;
+    for (int i = 0; i < n; ++i) {
+        SnapDrop sd;
+        snapshot_get(s, &sd, sizeof(sd));
+        sd.id[sizeof(sd.id)-1] = '\0';
+        int slot = drops.count;
+        spawn_drop(sd.id, sd.x, sd.y);
+        if (slot < drops.count) ((Drop*)pool_at(&drops, slot))->stack = sd.stack;
     }
-    // compute pixel size and offsets to center
-    int map_w = level_cols * TILE_SIZE;
-    int map_h = level_rows * TILE_SIZE;
-    level_offset_x = (WINDOW_WIDTH - map_w) / 2;
-    level_offset_y = (WINDOW_HEIGHT - map_h) / 2;
+    reset_resident_grids();
+    snap_interpolation();
     return TRUE;
 }
 
+// restart point for game over: the level as it was right after being set up
+static void save_level_start(void) {
+    if (!save_state(&level_start)) snapshot_free(&level_start);
+    // rewinding stops at a level change
+    snapshot_ring_clear(&rewind_ring);
+}
+
+// restart point for a level that was not entered the normal way (a quick load of another
+// level's state, a hot reload): the level as it is set up right now, but with the player's stats,
+// inventories and drops from the previous restart point, never the live ones
+static Snapshot start_fresh, start_next; // scratch, kept for their memory
+
+// offset of the spawn record section, just after the player, inventories and drops
+static size_t snap_world_at(Snapshot* s) {
+    int32_t n;
+    size_t skip = sizeof(SnapPlayer) + sizeof(SnapItem) * (CARD_SLOTS + OTHER_SLOTS);
+    if (snapshot_remaining(s) < skip) return 0;
+    s->pos += skip;
+    if (!snapshot_get(s, &n, sizeof(n)) || n < 0 || snapshot_remaining(s) < sizeof(SnapDrop) * (size_t)n) return 0;
+    return s->pos + sizeof(SnapDrop) * (size_t)n;
+}
+
+static void rebase_level_start(void) {
+    SnapPlayer p, old;
+    size_t fresh_world = save_state(&start_fresh) && snapshot_open(&start_fresh) ? snap_world_at(&start_fresh) : 0;
+    size_t old_world = snapshot_open(&level_start) ? snap_world_at(&level_start) : 0;
+    if (fresh_world == 0) return;
+    memcpy(&p, start_fresh.data + sizeof(SnapshotHeader), sizeof(p));
+    if (old_world) memcpy(&old, level_start.data + sizeof(SnapshotHeader), sizeof(old));
+    Snapshot t;
+    if (old_world == 0) {
+        // no earlier start to take the player from: this level's, without a game over
+        p.game_over = 0;
+        memcpy(start_fresh.data + sizeof(SnapshotHeader), &p, sizeof(p));
+    } else {
+        // the earlier start's player where this level puts them, its inventories and drops,
+        // then this level's spawn records and NPCs
+        old.x = p.x; old.y = p.y; old.dir = p.dir;
+        size_t items_at = sizeof(SnapshotHeader) + sizeof(SnapPlayer);
+        snapshot_begin(&start_next, level_path);
+        snapshot_put(&start_next, &old, sizeof(old));
+        snapshot_put(&start_next, level_start.data + items_at, old_world - items_at);
+        snapshot_put(&start_next, start_fresh.data + fresh_world, start_fresh.size - fresh_world);
+        if (!snapshot_end(&start_next)) return;
+        t = start_fresh; start_fresh = start_next; start_next = t;
+    }
+    t = level_start; level_start = start_fresh; start_fresh = t;
+    snapshot_ring_clear(&rewind_ring);
+}
+
+// --- Hot reload ---
+// Level, meta and image files edited while the game runs are applied between frames. A level
+// is read again and diffed against the running one: resident chunks whose tiles changed are
+// patched in place (and re-baked), spawn records are paired up by tile and letter so their
+// NPCs keep position, HP and AI state, new records spawn and deleted ones despawn. Player,
+// inventories and drops are untouched. Images are read again into the atlas regions holding
+// them. Off while recording or replaying: a recording only knows the files it started with.
+#ifndef GAME_NO_MAIN
+static int watching = 0;
+
+// whether path is the current level's text, meta or compiled file (levels/x.*)
+static int is_level_file(const char* path) {
+    const char* dot = strrchr(level_path, '.');
+    const char* slash = strrchr(level_path, '/');
+    size_t stem = dot && (!slash || dot > slash) ? (size_t)(dot - level_path) : strlen(level_path);
+    return strncmp(path, level_path, stem) == 0 && path[stem] == '.';
+}
+
+// pair the spawn records of an edited level with the current ones (same tile and letter).
+// Both lists are in reading order, so one merge pass does it. from: per new record, the old
+// one it continues or -1; to: per old record, its new index or -1
+static void match_spawns(const LevelData* old, const LevelData* lv, int* from, int* to) {
+    int i = 0, j = 0;
+    for (int k = 0; k < old->npc_count; ++k) to[k] = -1;
+    for (int k = 0; k < lv->npc_count; ++k) from[k] = -1;
+    while (i < old->npc_count && j < lv->npc_count) {
+        const LevelNpcSpawn *a = &old->npcs[i], *b = &lv->npcs[j];
+        if (a->row < b->row || (a->row == b->row && a->col < b->col)) { i++; continue; }
+        if (b->row < a->row || (a->row == b->row && b->col < a->col)) { j++; continue; }
+        if (a->id == b->id) { from[j] = i; to[i] = j; }
+        i++; j++;
+    }
+}
+
+// restart goes to the start of the edited level (and rewinding stops here): set the level up
+// afresh to take that from, then put the running game back
+static void rebase_after_reload(void) {
+    static Snapshot live;
+    if (!save_state(&live)) return;
+    if (!level_apply()) {
+        fprintf(stderr, "Out of memory installing level\n");
+        return;
+    }
+    rebase_level_start();
+    restore_state(&live);
+}
+
+// a level that changed size (or could not be patched) gets a new world; the player stays
+// where they are when that is still inside it
+static void reinstall_level(LevelData lv) {
+    char path[sizeof(level_path)];
+    memcpy(path, level_path, sizeof(path));
+    float px = player.x, py = player.y;
+    if (!install_level(lv, path)) return;
+    rebase_level_start();
+    if ((py + player.height/2.0f) / TILE_SIZE < level_rows && (px + player.width/2.0f) / TILE_SIZE < level_cols) {
+        player.x = px; player.y = py;
+        update_residency();
+        snap_interpolation();
+    }
+    add_hud_message("Reloaded %s (new size, NPCs reset)", path);
+}
+
+static void reload_level(void) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    LevelData lv;
+    if (!level_load(level_path, &lv)) {
+        add_hud_message("Could not reload %s", level_path);
+        return;
+    }
+    if (lv.rows != current_level.rows || lv.cols != current_level.cols) { reinstall_level(lv); return; }
+    int* from = malloc(sizeof(int) * ((size_t)lv.npc_count + 1));
+    int* to = malloc(sizeof(int) * ((size_t)current_level.npc_count + 1));
+    if (!from || !to) { free(from); free(to); reinstall_level(lv); return; }
+    match_spawns(&current_level, &lv, from, to);
+    int removed = 0, added = 0;
+    for (int k = 0; k < current_level.npc_count; ++k) removed += to[k] < 0;
+    int lights_changed = lv.light_count != current_level.light_count ||
+                         memcmp(lv.lights, current_level.lights, sizeof(LevelLight) * (size_t)lv.light_count) != 0;
+
+    // NPCs of deleted records leave, the rest follow their record to its new index (walking
+    // backwards, so the NPC swapped into a freed slot has already been renumbered)
+    for (int i = npcs.count - 1; i >= 0; --i) {
+        int k = npc_cold[i].spawn;
+        if (k < 0) continue;
+        if (to[k] < 0) npc_remove(i);
+        else npc_cold[i].spawn = to[k];
+    }
+    LevelData old = current_level;
+    current_level = lv;
+    int patched = world_patch(&current_level, level_remap(&current_level), from, NULL);
+    if (patched < 0) {
+        current_level = old;
+        free(from); free(to);
+        reinstall_level(lv);
+        return;
+    }
+    level_free(&old);
+
+    // resident NPCs take their record's fixed data (side, HP cap, drop, dialog, sprite)
+    for (int i = 0; i < npcs.count; ++i) {
+        if (npc_cold[i].spawn < 0) continue;
+        npc_from_spawn(i, npc_cold[i].spawn);
+        if (npcs.hp[i] > npc_cold[i].max_hp) npcs.hp[i] = npc_cold[i].max_hp;
+    }
+    // new records in resident chunks appear right away, the rest when their chunk loads
+    for (int k = 0; k < current_level.npc_count; ++k) {
+        if (from[k] >= 0) continue;
+        added++;
+        int chunk = world.spawns[k].chunk;
+        if (chunk >= 0 && world.directory[chunk] >= 0) spawn_from_record(k);
+    }
+    free(from); free(to);
+    // light is blocked by walls, so any tile change can move it
+    if (lights_changed || patched > 0) {
+        light_set_level(renderer ? &current_level : NULL);
+        for (int i = 0; i < world.slot_count; ++i) if (world.slots[i].cr >= 0) light_bake_chunk(i);
+    }
+    reset_resident_grids();
+    rebase_after_reload();
+    double ms = (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    add_hud_message("Reloaded %s: %d chunks, +%d -%d NPCs (%.1f ms)", level_path, patched, added, removed, ms);
+}
+
+// an image or animation file changed: read it again into whatever uses it
+static void reload_asset(const char* path) {
+    size_t len = strlen(path);
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    if (len > 5 && strcmp(path + len - 5, ".anim") == 0) {
+        if (strcmp(path, "assets/player.anim") == 0) load_player_anim();
+        else if (strncmp(path, "assets/entities/", 16) == 0 && strlen(name) == 6 && entity_anim_ready[name[0] & 127]) load_entity_anim(name[0]);
+        else return;
+        add_hud_message("Reloaded %s", path);
+        return;
+    }
+    if (len <= 4 || strcmp(path + len - 4, ".png") != 0) return;
+    int n = atlas_reload_file(path);
+    // the token named by the file, if its image is this file
+    char token[TOKEN_SIZE], token_path[512];
+    size_t tlen = (size_t)(path + len - 4 - name);
+    uint16_t id = TILE_NONE;
+    int w, h;
+    if (tlen > 0 && tlen < TOKEN_SIZE) {
+        memcpy(token, name, tlen); token[tlen] = '\0';
+        id = token_find(token);
+        if (id != TILE_NONE) token_image_info(token, token_path, sizeof(token_path), &w, &h);
+        if (id != TILE_NONE && strcmp(token_path, path) != 0) id = TILE_NONE;
+    }
+    // a token whose file was missing so far still shows its colored block: give it the image
+    if (n == 0 && id != TILE_NONE && renderer && atlas_add_file(path, w, h, &token_sprites[id])) {
+        n = 1;
+        if (isalpha((unsigned char)token[0]) && entity_anim_ready[token[0] & 127]) load_entity_anim(token[0]);
+    }
+    if (n == 0) return;
+    // chunks keep tiles baked into their own textures
+    for (int i = 0; id != TILE_NONE && i < world.slot_count; ++i) {
+        WorldChunk* ch = &world.slots[i];
+        if (ch->cr < 0 || ch->dirty) continue;
+        for (int c = 0; c < WORLD_CHUNK_TILES * WORLD_CHUNK_TILES; ++c) if (ch->tiles[c] == id) { ch->dirty = 1; break; }
+    }
+    add_hud_message("Reloaded %s", path);
+}
+
+// between frames: apply the level and asset files written since the last frame
+static void poll_hot_reload(void) {
+    if (!watching) return;
+    char path[512];
+    int level_changed = FALSE;
+    while (watch_next(path, sizeof(path))) {
+        const char* p = strncmp(path, "./", 2) == 0 ? path + 2 : path;
+        // saving the text and the meta together reloads once
+        if (is_level_file(p)) level_changed = TRUE;
+        else reload_asset(p);
+    }
+    // a level about to be swapped in replaces this one anyway
+    if (level_changed && loader_status() == LOADER_IDLE) reload_level();
+}
+
+static void start_hot_reload(void) {
+    if (!hot_reload || headless || record_path || replaying || !watch_init()) return;
+    char dir[sizeof(level_path)];
+    snprintf(dir, sizeof(dir), "%s", level_path);
+    char* slash = strrchr(dir, '/');
+    if (slash) *slash = '\0';
+    else snprintf(dir, sizeof(dir), ".");
+    watch_dir(dir);
+    watch_dir("assets");
+    watch_dir("assets/tiles");
+    watch_dir("assets/entities");
+    watching = TRUE;
+}
+
+// --compile-level: text level + .meta -> .lvlb (no SDL needed)
+static int compile_level(const char* in, const char* out) {
+    LevelData lv;
+    if (!level_parse_text(in, &lv)) {
+        fprintf(stderr, "Failed to open level file '%s'\n", in);
+        return FALSE;
+    }
+    int ok = level_write_binary(&lv, out);
+    if (ok) fprintf(stdout, "%s -> %s (%dx%d, %d tokens, %d NPCs)\n", in, out, lv.rows, lv.cols, lv.token_count - 1, lv.npc_count);
+    else fprintf(stderr, "Failed to write compiled level '%s'\n", out);
+    level_free(&lv);
+    return ok;
+}
+#endif
+
 void process_input() {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
@@ -721,106 +1354,123 @@ void process_input() {
                 game_is_running = FALSE;
                 break;
             case SDL_KEYDOWN:
+                // game keys become timestamped actions for the simulation ticks
+                if (input_handle_event(&event)) break;
                 if (event.key.keysym.sym == SDLK_ESCAPE) game_is_running = FALSE;
-                if (event.key.keysym.sym == SDLK_e) {
-                    // store a simple event in the key state by posting a custom SDL user event
-                    SDL_PushEvent(&(SDL_Event){ .type = SDL_USEREVENT, .user = { .code = 1 } });
+                if (event.key.keysym.sym == SDLK_F3) show_profiler = !show_profiler;
+                if (event.key.keysym.sym == SDLK_EQUALS || event.key.keysym.sym == SDLK_KP_PLUS) {
+                    render_scale += CAMERA_ZOOM_STEP;
+                    if (render_scale > CAMERA_MAX_SCALE) render_scale = CAMERA_MAX_SCALE;
+                }
+                if (event.key.keysym.sym == SDLK_MINUS || event.key.keysym.sym == SDLK_KP_MINUS) {
+                    render_scale -= CAMERA_ZOOM_STEP;
+                    if (render_scale < CAMERA_MIN_SCALE) render_scale = CAMERA_MIN_SCALE;
+                }
+                if (event.key.keysym.sym == SDLK_F4) {
+                    const char* path = profile_trace_path ? profile_trace_path : "profile_trace.json";
+                    if (prof_write_trace(path)) add_hud_message("Trace written to %s", path);
+                    else add_hud_message("Could not write %s", path);
+                }
+                if (event.key.keysym.sym == SDLK_F5) {
+                    if (save_state(&quick_save) && snapshot_write_file(&quick_save, QUICKSAVE_PATH)) add_hud_message("Saved to %s", QUICKSAVE_PATH);
+                    else add_hud_message("Could not write %s", QUICKSAVE_PATH);
+                }
+                if (event.key.keysym.sym == SDLK_F9) {
+                    if (record_path || replaying) add_hud_message("Can't load while recording or replaying");
+                    else if (!snapshot_read_file(&quick_save, QUICKSAVE_PATH)) add_hud_message("No quick save");
+                    else if (restore_state(&quick_save)) add_hud_message("Loaded %s", QUICKSAVE_PATH);
+                    else add_hud_message("Could not load %s", QUICKSAVE_PATH);
                 }
+                if (event.key.keysym.sym == SDLK_r) rewinding = 1;
                 break;
-            case SDL_USEREVENT:
-                // handled in update via flag polling
+            case SDL_KEYUP:
+                if (event.key.keysym.sym == SDLK_r) rewinding = 0;
+                input_handle_event(&event);
+                break;
+            case SDL_WINDOWEVENT:
+                if (event.window.event == SDL_WINDOWEVENT_FOCUS_LOST) rewinding = 0;
+                input_handle_event(&event);
                 break;
         }
     }
 }
 
+// build the sprite atlas: fallbacks, player sprites, tiles and entities (skipped in headless mode)
+static void setup_textures(void) {
+    if (!atlas_init(renderer)) fprintf(stderr, "Could not create sprite atlas: %s\n", SDL_GetError());
+
+    // create simple fallback sprites (colored rectangles) for missing assets
+    atlas_add_color((SDL_Color){ 80, 80, 80, 255 }, TILE_SIZE, TILE_SIZE, &fallback_tile);
+    atlas_add_color((SDL_Color){ 160, 100, 40, 255 }, TILE_SIZE, TILE_SIZE, &fallback_entity);
+    atlas_add_color((SDL_Color){ 0, 0, 255, 255 }, (int)player.width, (int)player.height, &fallback_player);
+
+    load_player_anim();
+
+    preload_atlas_dir("assets/tiles", 0);
+    preload_atlas_dir("assets/entities", 1);
+}
+
+// initialize TTF and the inventory placeholder textures (skipped in headless mode)
+static void setup_ui(void) {
+    if (TTF_Init() == -1) fprintf(stderr, "TTF_Init error: %s\n", TTF_GetError());
+    ui_font = TTF_OpenFont("assets/DejaVuSans.ttf", 16);
+    if (!ui_font) {
+        fprintf(stderr, "Could not open font, falling back to bitmap font: %s\n", TTF_GetError());
+    }
+    // pack the font glyphs into the atlas so text never touches TTF again
+    text_init(ui_font);
+    // create simple placeholders (solid blocks, stretched to the slot size when drawn)
+    atlas_add_color((SDL_Color){ 60,60,60,255 }, 8, 8, &ui_slot);
+    atlas_add_color((SDL_Color){ 160,120,40,255 }, 8, 8, &ui_card_placeholder);
+    atlas_add_color((SDL_Color){ 40,160,40,255 }, 8, 8, &ui_item_placeholder);
+}
+
 void setup() {
     player.width = 24;
     player.height = 31;
     player.x = (WINDOW_WIDTH - player.width) / 2.0f;
     player.y = (WINDOW_HEIGHT - player.height) / 2.0f;
 
-    // create simple fallback textures (colored rectangles) for missing assets
-    // fallback_tile: dark gray
-    SDL_Surface* s = SDL_CreateRGBSurfaceWithFormat(0, TILE_SIZE, TILE_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
-    if (s) {
-        SDL_FillRect(s, NULL, SDL_MapRGBA(s->format, 80, 80, 80, 255));
-        fallback_tile = SDL_CreateTextureFromSurface(renderer, s);
-        SDL_FreeSurface(s);
-    }
-    // fallback_entity: brown
-    s = SDL_CreateRGBSurfaceWithFormat(0, TILE_SIZE, TILE_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
-    if (s) {
-        SDL_FillRect(s, NULL, SDL_MapRGBA(s->format, 160, 100, 40, 255));
-        fallback_entity = SDL_CreateTextureFromSurface(renderer, s);
-        SDL_FreeSurface(s);
-    }
-    // fallback_player: blue rectangle
-    s = SDL_CreateRGBSurfaceWithFormat(0, (int)player.width, (int)player.height, 32, SDL_PIXELFORMAT_RGBA32);
-    if (s) {
-        SDL_FillRect(s, NULL, SDL_MapRGBA(s->format, 0, 0, 255, 255));
-        fallback_player = SDL_CreateTextureFromSurface(renderer, s);
-        SDL_FreeSurface(s);
-    }
-
-    player_tex = IMG_LoadTexture(renderer, "assets/player.png");
-    if (!player_tex) {
-        fprintf(stderr, "Could not load player texture: %s\n", IMG_GetError());
-        player_tex = fallback_player;
-    }
-
-    // load directional player sprites (optional)
-    player_tex_up = IMG_LoadTexture(renderer, "assets/playeru.png");
-    if (!player_tex_up) { player_tex_up = player_tex; }
-    player_tex_right = IMG_LoadTexture(renderer, "assets/playerr.png");
-    if (!player_tex_right) { player_tex_right = player_tex; }
-    player_tex_left = IMG_LoadTexture(renderer, "assets/playerl.png");
-    if (!player_tex_left) { player_tex_left = player_tex; }
+    if (!headless) setup_textures();
+    jobs_init(job_threads);
+    npc_init(MAX_NPCS, max_npcs);
+    spatial_init(&npc_grid, MAX_NPCS, TILE_SIZE);
+    spatial_init(&drop_grid, MAX_DROPS, TILE_SIZE);
+    pool_init(&drops, MAX_DROPS, sizeof(Drop));
+    pool_init(&hud_msgs, HUD_MSG_MAX, sizeof(HudMsg));
+    pool_init(&dmg_popups, DMG_POPUP_MAX, sizeof(DmgPopup));
+    // nobody can hold R in a headless run
+    if (!headless) snapshot_ring_init(&rewind_ring, REWIND_TICKS);
 
     // default facing down
     player_dir = DIR_DOWN;
 
-    load_level("levels/level1.txt");
+    load_level(start_level);
     // init inventories and player stats
     init_inventories();
     player_level = 1;
     player_max_hp = 100 + (player_level - 1) * 20;
     player_hp = player_max_hp;
     player_defense_pct = 0; // start with 0% damage reduction
-    // disable automatic zoom — use scale 1.0
     render_scale = 1.5f;
-        // initialize TTF and UI textures
-        if (TTF_Init() == -1) fprintf(stderr, "TTF_Init error: %s\n", TTF_GetError());
-        ui_font = TTF_OpenFont("assets/DejaVuSans.ttf", 16);
-        if (!ui_font) {
-            fprintf(stderr, "Could not open font, falling back to bitmap font: %s\n", TTF_GetError());
-        }
-    // create simple placeholders
-    s = SDL_CreateRGBSurfaceWithFormat(0, 48, 48, 32, SDL_PIXELFORMAT_RGBA32);
-        if (s) {
-            SDL_FillRect(s, NULL, SDL_MapRGBA(s->format, 60,60,60,255));
-            ui_slot_tex = SDL_CreateTextureFromSurface(renderer, s);
-            SDL_FillRect(s, NULL, SDL_MapRGBA(s->format, 160,120,40,255));
-            ui_card_placeholder = SDL_CreateTextureFromSurface(renderer, s);
-            SDL_FillRect(s, NULL, SDL_MapRGBA(s->format, 40,160,40,255));
-            ui_item_placeholder = SDL_CreateTextureFromSurface(renderer, s);
-            SDL_FreeSurface(s);
-        }
+    if (!headless) setup_ui();
     // init drops and hud
-    drop_count = 0; memset(drops, 0, sizeof(drops));
-    hud_count = 0; memset(hud_msgs, 0, sizeof(hud_msgs));
+    clear_drops_and_hud();
+    // restart point: the first level as the player enters it
+    save_level_start();
 }
 
-void update() {
-    // get a delta time factor for updating object position
-    Uint32 now = SDL_GetTicks();
-    float delta_time = (now - last_frame_time) / 1000.0f;
-    last_frame_time = now;
+// advance the simulation by one fixed tick of delta_time seconds; input is INPUT_* bits
+void update(float delta_time, uint8_t input) {
+    // remember where everything was so render() can interpolate toward the new state
+    player.prev_x = player.x; player.prev_y = player.y;
+    memcpy(npcs.prev_x, npcs.x, sizeof(float) * npcs.count);
+    memcpy(npcs.prev_y, npcs.y, sizeof(float) * npcs.count);
+    sim_clock += delta_time;
 
-    const uint8_t *keystate = SDL_GetKeyboardState(NULL);
     if (game_over) {
-        // restart on Enter
-        if (keystate[SDL_SCANCODE_RETURN]) {
+        // restart on Enter: back to the state the level started in
+        if ((input & INPUT_CONFIRM) && !restore_state(&level_start)) {
             game_over = 0; player_level = 1; player_max_hp = 100; player_hp = player_max_hp; player_defense_pct = 5; init_inventories();
         }
         return;
@@ -828,10 +1478,10 @@ void update() {
     // game input (movement handled below)
     float speed = 100.0f;
     float dx = 0.0f, dy = 0.0f;
-    if (keystate[SDL_SCANCODE_LEFT] || keystate[SDL_SCANCODE_A]) dx -= speed * delta_time;
-    if (keystate[SDL_SCANCODE_RIGHT] || keystate[SDL_SCANCODE_D]) dx += speed * delta_time;
-    if (keystate[SDL_SCANCODE_UP] || keystate[SDL_SCANCODE_W]) dy -= speed * delta_time;
-    if (keystate[SDL_SCANCODE_DOWN] || keystate[SDL_SCANCODE_S]) dy += speed * delta_time;
+    if (input & INPUT_LEFT) dx -= speed * delta_time;
+    if (input & INPUT_RIGHT) dx += speed * delta_time;
+    if (input & INPUT_UP) dy -= speed * delta_time;
+    if (input & INPUT_DOWN) dy += speed * delta_time;
 
     // determine facing direction from movement input
     if (dx > 0) player_dir = DIR_RIGHT;
@@ -839,322 +1489,372 @@ void update() {
     else if (dy < 0) player_dir = DIR_UP;
     else if (dy > 0) player_dir = DIR_DOWN;
 
-    // collision check: simple tile-based blocking
-    float new_x = player.x + dx;
-    float new_y = player.y + dy;
-    int left = (int)(new_x) / TILE_SIZE;
-    int right = (int)(new_x + player.width - 1) / TILE_SIZE;
-    int top = (int)(player.y) / TILE_SIZE;
-    int bottom = (int)(player.y + player.height - 1) / TILE_SIZE;
-    int blocked_x = 0;
-    if (left < 0 || right >= level_cols) blocked_x = 1;
-    for (int rr = top; rr <= bottom && !blocked_x; ++rr) {
-        if (rr < 0 || rr >= level_rows) continue;
-        if (collision_map[rr][left] || collision_map[rr][right]) blocked_x = 1;
-    }
-    if (!blocked_x) player.x = new_x;
-
-    left = (int)(player.x) / TILE_SIZE;
-    right = (int)(player.x + player.width - 1) / TILE_SIZE;
-    top = (int)(new_y) / TILE_SIZE;
-    bottom = (int)(new_y + player.height - 1) / TILE_SIZE;
-    int blocked_y = 0;
-    if (top < 0 || bottom >= level_rows) blocked_y = 1;
-    for (int cc = left; cc <= right && !blocked_y; ++cc) {
-        if (cc < 0 || cc >= level_cols) continue;
-        if (collision_map[top][cc] || collision_map[bottom][cc]) blocked_y = 1;
-    }
-    if (!blocked_y) player.y = new_y;
+    // collision: swept against the tiles so a long tick can't skip a wall
+    WorldMove pm = world_move_and_slide(player.x, player.y, player.width, player.height, dx, dy);
+    player.x = pm.x; player.y = pm.y;
+    // stream chunks in and out as the player crosses chunk borders
+    update_residency();
 
     // check game over
     if (player_hp <= 0) {
         game_over = 1;
     }
 
-    // Player attack: space to hit nearest NPC in range
-    static int last_space = 0;
-    static int last_e = 0;
-    if (keystate[SDL_SCANCODE_SPACE]) {
-        if (!last_space) {
-            // first press: find nearest NPC within range
-            float best_dist = 999999.0f; int best_idx = -1;
-            for (int i = 0; i < npc_count; ++i) {
-                NPC *n = &npcs[i];
-                float nx = n->x + n->width/2.0f; float ny = n->y + n->height/2.0f;
-                float px = player.x + player.width/2.0f; float py = player.y + player.height/2.0f;
-                float dist = hypotf(nx-px, ny-py);
-                if (dist < 48.0f && dist < best_dist) { best_dist = dist; best_idx = i; }
-            }
-            if (best_idx >= 0) {
-                NPC *t = &npcs[best_idx];
-                // prevent killing neutral NPCs: only hostile NPCs take damage
-                if (!t->hostile) {
-                    add_hud_message("%c is neutral", t->id);
-                    // small visual feedback but no HP reduction
-                    spawn_dmg_popup(t->x + t->width/2, t->y, "0");
-                    t->hit_timer = 0.12f;
-                } else {
-                    int dmg = PLAYER_BASE_DAMAGE;
-                    t->hp -= dmg;
-                    // per-hit feedback
-                    spawn_dmg_popup(t->x + t->width/2, t->y, "-%d", dmg);
-                    t->hit_timer = 0.25f;
-                    if (t->hp <= 0) {
-                        // spawn drop on ground if specified
-                        if (t->drop_id[0] != '\0') {
-                            float dx = t->x + t->width/2.0f;
-                            float dy = t->y + t->height/2.0f;
-                            spawn_drop(t->drop_id, dx, dy);
-                            add_hud_message("Dropped: %s", t->drop_id);
-                        }
-                        // level gain for hostile kill
-                        player_level += t->level_on_kill;
-                        player_max_hp = 100 + (player_level - 1) * 20;
-                        player_hp += 10 * t->level_on_kill; if (player_hp > player_max_hp) player_hp = player_max_hp;
-                        add_hud_message("Killed %c: +%d level(s)", t->id, t->level_on_kill);
-                        // remove NPC: shift array
-                        for (int j = best_idx; j < npc_count-1; ++j) npcs[j] = npcs[j+1];
-                        npc_count--;
-                        // check remaining hostiles; if none, advance level
-                        int any_hostile = 0;
-                        for (int k = 0; k < npc_count; ++k) { if (npcs[k].hostile) { any_hostile = 1; break; } }
-                        if (!any_hostile) {
-                            add_hud_message("All hostiles defeated. Advancing level...");
-                            // reset drops and hud when moving to next level
-                            drop_count = 0; memset(drops, 0, sizeof(drops));
-                            hud_count = 0; memset(hud_msgs, 0, sizeof(hud_msgs));
-                            if (!load_level("levels/level2.txt")) {
-                                add_hud_message("No next level found");
-                            }
-                        }
+    // Player attack: space to hit nearest NPC in range (one hit per press)
+    if (input & INPUT_ATTACK) {
+        player_attack_at = sim_clock; // the swing plays whether or not it connects
+        // find nearest NPC within range
+        int best_idx = spatial_nearest(&npc_grid, player.x + player.width/2.0f, player.y + player.height/2.0f, 48.0f);
+        if (best_idx >= 0) {
+            int i = best_idx;
+            NpcCold *t = &npc_cold[i];
+            // prevent killing neutral NPCs: only hostile NPCs take damage
+            if (!npcs.hostile[i]) {
+                add_hud_message("%c is neutral", t->id);
+                // small visual feedback but no HP reduction
+                spawn_dmg_popup(npcs.x[i] + npcs.width[i]/2, npcs.y[i], "0");
+                npcs.hit_timer[i] = NPC_NEUTRAL_HIT_FLASH;
+            } else {
+                int dmg = PLAYER_BASE_DAMAGE;
+                npcs.hp[i] -= dmg;
+                // per-hit feedback
+                spawn_dmg_popup(npcs.x[i] + npcs.width[i]/2, npcs.y[i], "-%d", dmg);
+                npcs.hit_timer[i] = NPC_HIT_FLASH;
+                if (npcs.hp[i] <= 0) {
+                    // spawn drop on ground if specified
+                    if (t->drop_id[0] != '\0') {
+                        float dx = npcs.x[i] + npcs.width[i]/2.0f;
+                        float dy = npcs.y[i] + npcs.height[i]/2.0f;
+                        spawn_drop(t->drop_id, dx, dy);
+                        add_hud_message("Dropped: %s", t->drop_id);
+                    }
+                    // level gain for hostile kill
+                    player_level += t->level_on_kill;
+                    player_max_hp = 100 + (player_level - 1) * 20;
+                    player_hp += 10 * t->level_on_kill; if (player_hp > player_max_hp) player_hp = player_max_hp;
+                    add_hud_message("Killed %c: +%d level(s)", t->id, t->level_on_kill);
+                    // remove NPC for good: the last NPC is swapped into its slot, so relabel that grid entry
+                    world_spawn_kill(t->spawn);
+                    spatial_remove(&npc_grid, i);
+                    int moved = npc_remove(i);
+                    if (moved >= 0) spatial_rename(&npc_grid, moved, i);
+                    // check remaining hostiles anywhere in the world; if none, advance level
+                    if (world.hostiles_alive <= 0) {
+                        // the next level loads in the background; play goes on until it is swapped in
+                        if (request_level("levels/level2.txt")) add_hud_message("All hostiles defeated. Advancing level...");
                     }
                 }
             }
         }
-        last_space = 1;
-    } else last_space = 0;
+    }
 
     // Interaction: E to talk/show dialog to nearest NPC
-    if (keystate[SDL_SCANCODE_E]) {
-        if (!last_e) {
-            float best_dist = 999999.0f; int best_idx = -1;
-            for (int i = 0; i < npc_count; ++i) {
-                NPC *n = &npcs[i];
-                float nx = n->x + n->width/2.0f; float ny = n->y + n->height/2.0f;
-                float px = player.x + player.width/2.0f; float py = player.y + player.height/2.0f;
-                float dist = hypotf(nx-px, ny-py);
-                if (dist < 64.0f && dist < best_dist) { best_dist = dist; best_idx = i; }
-            }
-            if (best_idx >= 0) {
-                NPC *n = &npcs[best_idx];
-                if (n->dialog[0]) add_hud_message("%s", n->dialog);
-                else add_hud_message("%c: ...", n->id);
-            }
-        }
-        last_e = 1;
-    } else last_e = 0;
-
-    // NPC AI: wandering and hostile attacks
-    for (int i = 0; i < npc_count; ++i) {
-        NPC *n = &npcs[i];
-        // decrement timers
-        if (n->wander_timer > 0) n->wander_timer -= delta_time;
-        if (n->attack_cooldown > 0) n->attack_cooldown -= delta_time;
-        if (n->hit_timer > 0) n->hit_timer -= delta_time;
-        // wandering: pick a velocity occasionally and apply smooth motion
-        if (n->wander_timer <= 0) {
-            float ang = ((float)(rand() % 360)) * 3.14159f / 180.0f;
-            n->vx = cosf(ang) * n->speed;
-            n->vy = sinf(ang) * n->speed;
-            n->wander_timer = 0.5f + (rand()%100)/100.0f; // short bursts
-        }
-        // apply velocity with damping for smooth movement
-        float try_x = n->x + n->vx * delta_time;
-        float try_y = n->y + n->vy * delta_time;
-        // test collisions and adjust
-        if (!npc_will_collide(try_x, n->y, n->width, n->height)) n->x = try_x; else n->vx *= -0.5f;
-        if (!npc_will_collide(n->x, try_y, n->width, n->height)) n->y = try_y; else n->vy *= -0.5f;
-        // damping
-        n->vx *= 0.95f; n->vy *= 0.95f;
-        // clamp to level bounds
-    if (n->x < 0) n->x = 0;
-    if (n->y < 0) n->y = 0;
-        if (n->x > level_cols*TILE_SIZE - n->width) n->x = level_cols*TILE_SIZE - n->width;
-        if (n->y > level_rows*TILE_SIZE - n->height) n->y = level_rows*TILE_SIZE - n->height;
-
-        // hostile behavior: if player is near, attack
-        if (n->hostile) {
-            float nx = n->x + n->width/2.0f; float ny = n->y + n->height/2.0f;
-            float px = player.x + player.width/2.0f; float py = player.y + player.height/2.0f;
-            float dist = hypotf(nx-px, ny-py);
-            if (dist < 200.0f) {
-                // move toward player smoothly
-                float dirx = (px - nx); float diry = (py - ny);
-                float len = hypotf(dirx, diry); if (len > 0.001f) { dirx/=len; diry/=len; }
-                // apply to velocity so movement stays smooth and collidable
-                n->vx += dirx * 40.0f * delta_time;
-                n->vy += diry * 40.0f * delta_time;
-                // clamp speed
-                float sp = hypotf(n->vx, n->vy); if (sp > 60.0f) { n->vx = n->vx / sp * 60.0f; n->vy = n->vy / sp * 60.0f; }
-                // attack if in melee range and cooldown elapsed
-                if (dist < 34.0f && n->attack_cooldown <= 0) {
-                    int dmg = NPC_BASE_DAMAGE + (n->level_on_kill);
-                    // apply defense reduction
-                    int reduced = (int)(dmg * (100 - player_defense_pct) / 100.0f);
-                    player_hp -= reduced;
-                    // visual feedback
-                    player_hit_timer = 0.35f;
-                    spawn_dmg_popup(player.x + player.width/2, player.y, "-%d", reduced);
-                    n->attack_cooldown = 1.0f; // 1 second cooldown
-                }
-            }
+    if (input & INPUT_TALK) {
+        int best_idx = spatial_nearest(&npc_grid, player.x + player.width/2.0f, player.y + player.height/2.0f, 64.0f);
+        if (best_idx >= 0) {
+            NpcCold *n = &npc_cold[best_idx];
+            // talking again replaces the dialog line on screen instead of stacking another
+            int shown = pool_slot(&hud_msgs, dialog_msg);
+            if (shown >= 0) pool_remove(&hud_msgs, shown);
+            if (n->dialog[0]) dialog_msg = add_hud_message("%s", n->dialog);
+            else dialog_msg = add_hud_message("%c: ...", n->id);
         }
     }
 
+    prof_begin(PROF_NPC_AI);
+    // NPC AI runs on the job workers in two passes. Movement touches only each NPC's own
+    // slot; the grid update between the passes is serial; attacks on the player come back as
+    // per-worker events that are applied in NPC order, so the outcome is the same for any
+    // number of threads.
+    NpcAiJob job = { delta_time, (float)(level_cols*TILE_SIZE), (float)(level_rows*TILE_SIZE), 0, 0, NULL };
+    jobs_parallel_for(npcs.count, NPC_JOB_GRAIN, npc_move_range, &job);
+    for (int i = 0; i < npcs.count; ++i) spatial_move(&npc_grid, i, npcs.x[i] + npcs.width[i]/2.0f, npcs.y[i] + npcs.height[i]/2.0f);
+
+    // hostile behavior: only NPCs the grid finds near the player can chase or attack
+    int *near_ids = npcs.scratch;
+    float pcx = player.x + player.width/2.0f, pcy = player.y + player.height/2.0f;
+    int near_count = spatial_query_radius(&npc_grid, pcx, pcy, 200.0f, near_ids, npcs.count);
+    // handle them in array order so damage and popups don't depend on grid layout
+    for (int a = 1; a < near_count; ++a) {
+        int v = near_ids[a], b = a - 1;
+        while (b >= 0 && near_ids[b] > v) { near_ids[b+1] = near_ids[b]; b--; }
+        near_ids[b+1] = v;
+    }
+    // the field only changes when the player reaches another tile (or the window moves)
+    flow_update(&flow, (int)(pcy / TILE_SIZE), (int)(pcx / TILE_SIZE), FLOW_MAX_DIST);
+    job.pcx = pcx; job.pcy = pcy; job.ids = near_ids;
+    for (int w = 0; w < jobs_worker_count(); ++w) npc_attack_count[w] = 0;
+    jobs_parallel_for(near_count, NPC_JOB_GRAIN, npc_chase_range, &job);
+    apply_npc_attacks();
+
+    prof_end(PROF_NPC_AI);
+
     // pickup check: player picks up nearby drops
-    for (int di = 0; di < drop_count; ++di) {
-        Drop *d = &drops[di];
-        if (!d->exists) continue;
-        float dx = (d->x) - (player.x + player.width/2.0f);
-        float dy = (d->y) - (player.y + player.height/2.0f);
-        float dist = hypotf(dx, dy);
-        if (dist <= PICKUP_RANGE) {
-            // try add to inventory, assume cards start with 'C'
-            Item it; clear_item(&it); strncpy(it.id, d->id, sizeof(it.id)-1);
-            if (d->id[0] == 'C') it.type = ITEM_CARD; else it.type = ITEM_WEAPON;
-            it.stack = d->stack; it.max_stack = 3; it.tex = d->tex;
-            int ok = add_item_to_inventory(it);
-            if (ok) {
-                add_hud_message("Picked up %s", d->id);
-                d->exists = 0;
-            }
+    prof_begin(PROF_PICKUP);
+    int near_drops[MAX_DROPS];
+    int near_drop_count = spatial_query_radius(&drop_grid, pcx, pcy, PICKUP_RANGE, near_drops, MAX_DROPS);
+    // highest slot first: removing a drop moves the last one into its slot, and that one is
+    // never still to be visited
+    qsort(near_drops, (size_t)near_drop_count, sizeof(int), cmp_int_desc);
+    for (int k = 0; k < near_drop_count; ++k) {
+        int di = near_drops[k];
+        Drop *d = pool_at(&drops, di);
+        // try add to inventory, assume cards start with 'C'
+        Item it; clear_item(&it); snprintf(it.id, sizeof(it.id), "%s", d->id);
+        if (d->id[0] == 'C') it.type = ITEM_CARD; else it.type = ITEM_WEAPON;
+        it.stack = d->stack; it.max_stack = 3; it.sprite = d->sprite;
+        int ok = add_item_to_inventory(it);
+        if (ok) {
+            add_hud_message("Picked up %s", d->id);
+            remove_drop(di);
         }
     }
 
-    // HUD message timers
-    for (int hi = 0; hi < hud_count; ++hi) {
-        if (hud_msgs[hi].timer > 0) hud_msgs[hi].timer -= delta_time;
-    }
-    // prune expired messages compactly
-    int wr = 0;
-    for (int hi = 0; hi < hud_count; ++hi) {
-        if (hud_msgs[hi].timer > 0) { if (wr != hi) hud_msgs[wr] = hud_msgs[hi]; wr++; }
+    prof_end(PROF_PICKUP);
+
+    // HUD message timers; walk backwards so a removal only moves an entry already visited
+    for (int hi = hud_msgs.count - 1; hi >= 0; --hi) {
+        HudMsg *m = pool_at(&hud_msgs, hi);
+        m->timer -= delta_time;
+        if (m->timer <= 0) pool_remove(&hud_msgs, hi);
     }
-    hud_count = wr;
 
     // decrement hit timers and update damage popups
     if (player_hit_timer > 0) player_hit_timer -= delta_time;
-    for (int pi = 0; pi < dmg_popup_count; ++pi) {
-        DmgPopup *p = &dmg_popups[pi];
-        if (p->timer > 0) {
-            p->y -= 20.0f * delta_time;
-            p->timer -= delta_time;
+    for (int pi = dmg_popups.count - 1; pi >= 0; --pi) {
+        DmgPopup *p = pool_at(&dmg_popups, pi);
+        p->y -= 20.0f * delta_time;
+        p->timer -= delta_time;
+        if (p->timer <= 0) pool_remove(&dmg_popups, pi);
+    }
+}
+
+#ifndef GAME_NO_MAIN
+static uint32_t hash_bytes(uint32_t h, const void* data, size_t n) {
+    const uint8_t* p = data;
+    for (size_t k = 0; k < n; ++k) { h ^= p[k]; h *= 16777619u; }
+    return h;
+}
+
+// FNV-1a over the simulation state a replay has to reproduce exactly
+static uint32_t state_hash(void) {
+    uint32_t h = 2166136261u;
+    int ints[6] = { player_hp, player_level, game_over, npcs.count, world.hostiles_alive, drops.count };
+    h = hash_bytes(h, &player.x, sizeof(player.x));
+    h = hash_bytes(h, &player.y, sizeof(player.y));
+    h = hash_bytes(h, ints, sizeof(ints));
+    size_t n = (size_t)npcs.count;
+    h = hash_bytes(h, npcs.x, sizeof(float) * n);
+    h = hash_bytes(h, npcs.y, sizeof(float) * n);
+    h = hash_bytes(h, npcs.vx, sizeof(float) * n);
+    h = hash_bytes(h, npcs.vy, sizeof(float) * n);
+    h = hash_bytes(h, npcs.hp, sizeof(int) * n);
+    h = hash_bytes(h, npcs.rng, sizeof(uint32_t) * n);
+    return h;
+}
+
+// run one tick on the input queued up to tick_end (SDL ms), or on the recording's while
+// replaying (and check the result against it). --record logs the input either way. FALSE when
+// the replay is over.
+static int sim_tick(float dt, uint32_t tick_end) {
+    uint8_t input;
+    uint32_t expected = 0;
+    // the queue is drained during a replay too, so keys pressed meanwhile don't pile up
+    uint8_t queued = input_tick(tick_end);
+    // rewinding steps back a tick instead (recordings must stay a plain run of inputs)
+    int can_rewind = !record_path && !replaying && rewind_ring.capacity > 0;
+    if (rewinding && can_rewind) {
+        restore_state(snapshot_ring_pop(&rewind_ring));
+        return TRUE;
+    }
+    if (can_rewind) save_state(snapshot_ring_push(&rewind_ring));
+    if (replaying) {
+        if (!replay_next(&input, &expected)) {
+            replaying = 0;
+            replay_close();
+            if (!headless) add_hud_message("Replay finished");
+            return FALSE;
         }
+        if (input & REPLAY_LEVEL_SWAP) finish_level_load();
+    } else input = queued | level_swap_flag;
+    level_swap_flag = 0;
+    update(dt, input & (uint8_t)~REPLAY_LEVEL_SWAP);
+    uint32_t hash = record_path || replaying ? state_hash() : 0;
+    if (record_path) replay_record_tick(input, hash);
+    if (replaying && hash != expected) {
+        fprintf(stderr, "Replay diverged at tick %d (state %08x, recorded %08x)\n", replay_tick(), (unsigned)hash, (unsigned)expected);
+        if (!headless) add_hud_message("Replay diverged at tick %d", replay_tick());
+        replay_failed = 1;
+        replaying = 0;
+        replay_close();
+        return FALSE;
     }
-    // compact expired dmg popups
-    int wp = 0;
-    for (int pi = 0; pi < dmg_popup_count; ++pi) if (dmg_popups[pi].timer > 0) { if (wp != pi) dmg_popups[wp] = dmg_popups[pi]; wp++; }
-    dmg_popup_count = wp;
+    return TRUE;
+}
+#endif
+
+// whether a resident chunk overlaps the view
+static int chunk_on_screen(const WorldChunk* ch) {
+    const int chunk_px = WORLD_CHUNK_TILES * TILE_SIZE;
+    return camera_sees(&camera, (float)(ch->cc * chunk_px), (float)(ch->cr * chunk_px), chunk_px, chunk_px);
+}
+
+// player frame: hit while flashing, the swing after an attack, walking while it moved last
+// tick, else idle; a clip restarts whenever the state changes
+static const Sprite* player_sprite(void) {
+    AnimState st = ANIM_IDLE;
+    if (player_hit_timer > 0) st = ANIM_HIT;
+    else if (sim_clock - player_attack_at < anim_length(&player_anim, ANIM_ATTACK, player_dir)) st = ANIM_ATTACK;
+    else if (player.x != player.prev_x || player.y != player.prev_y) st = ANIM_WALK;
+    if (st == ANIM_ATTACK && player_anim_state != ANIM_ATTACK) player_anim_since = player_attack_at;
+    else if (st != player_anim_state) player_anim_since = sim_clock;
+    player_anim_state = st;
+    return anim_frame(&player_anim, st, player_dir, (float)(sim_clock - player_anim_since));
+}
+
+// NPC frame from its hot data alone: facing from velocity, the attack clip while its cooldown
+// is fresh, hit while flashing. Both clips are timed from the hit/attack itself (the timers
+// count down from a known length); an NPC that has not attacked yet has no cooldown running.
+// Looping clips are phase-shifted by handle so crowds don't step in lockstep
+static const Sprite* npc_sprite(int i) {
+    const AnimSheet* a = npc_cold[i].anim;
+    float vx = npcs.vx[i], vy = npcs.vy[i];
+    int dir = fabsf(vx) > fabsf(vy) ? (vx > 0 ? DIR_RIGHT : DIR_LEFT) : vy < 0 ? DIR_UP : DIR_DOWN;
+    if (npcs.hit_timer[i] > 0) {
+        float flash = npcs.hostile[i] ? NPC_HIT_FLASH : NPC_NEUTRAL_HIT_FLASH;
+        return anim_frame(a, ANIM_HIT, dir, flash - npcs.hit_timer[i]);
+    }
+    float since_attack = NPC_ATTACK_COOLDOWN - npcs.attack_cooldown[i];
+    if (npcs.attack_cooldown[i] > 0 && since_attack < anim_length(a, ANIM_ATTACK, dir))
+        return anim_frame(a, ANIM_ATTACK, dir, since_attack);
+    float t = (float)sim_clock + (float)(npcs.handle[i] & 0xFF) * 0.1f;
+    return anim_frame(a, vx * vx + vy * vy > 1.0f ? ANIM_WALK : ANIM_IDLE, dir, t);
 }
 
 void render() {
+    const SDL_Color no_tint = { 255, 255, 255, 255 };
+    const int chunk_px = WORLD_CHUNK_TILES * TILE_SIZE;
+    const float scale = render_scale;
+    float player_draw_x = lerpf(player.prev_x, player.x, render_alpha);
+    float player_draw_y = lerpf(player.prev_y, player.y, render_alpha);
+    camera_follow(&camera, player_draw_x + player.width/2.0f, player_draw_y + player.height/2.0f,
+                  (float)(level_cols * TILE_SIZE), (float)(level_rows * TILE_SIZE), WINDOW_WIDTH, WINDOW_HEIGHT, scale);
+    // only tiles and entities overlapping this rectangle are submitted
+    int vr0, vc0, vr1, vc1;
+    int any_tiles = camera_visible_tiles(&camera, TILE_SIZE, level_rows, level_cols, &vr0, &vc0, &vr1, &vc1);
+
+    prof_begin(PROF_TILES);
+    // (re)bake visible chunks that were streamed in since they were last drawn
+    int baked = renderer && SDL_RenderTargetSupported(renderer);
+    for (int i = 0; i < world.slot_count && baked; ++i) {
+        WorldChunk* ch = &world.slots[i];
+        if (ch->cr >= 0 && ch->dirty && chunk_on_screen(ch)) bake_chunk(ch);
+    }
+
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
-
-    // draw map (no zoom)
-    for (int r = 0; r< level_rows; ++r) {
-        for (int c = 0; c < level_cols; ++c) {
-            char* tok = level_tiles[r][c];
-            if (tok[0] == '\0') continue;
-            SDL_Texture* tex = load_texture_for_token(tok);
-            if (!tex) continue;
-            SDL_Rect dst = { level_offset_x + c * TILE_SIZE, level_offset_y + r * TILE_SIZE, TILE_SIZE, TILE_SIZE };
-            SDL_RenderCopy(renderer, tex, NULL, &dst);
+    batch_begin(renderer);
+
+    // draw the map from the prebaked chunk textures
+    for (int i = 0; i < world.slot_count && any_tiles; ++i) {
+        const WorldChunk* ch = &world.slots[i];
+        if (ch->cr < 0 || !chunk_on_screen(ch)) continue;
+        int tr0 = ch->cr * WORLD_CHUNK_TILES, tc0 = ch->cc * WORLD_CHUNK_TILES;
+        if (baked && ch->tex && !ch->dirty) {
+            batch_flush();
+            SDL_FRect dst = { camera_screen_x(&camera, (float)(tc0 * TILE_SIZE)), camera_screen_y(&camera, (float)(tr0 * TILE_SIZE)), chunk_px * scale, chunk_px * scale };
+            SDL_RenderCopyF(renderer, ch->tex, NULL, &dst);
+            continue;
         }
-    }
-
-    // render NPCs
-    for (int i = 0; i < npc_count; ++i) {
-    NPC *n = &npcs[i];
-    SDL_Rect nd = { level_offset_x + (int)n->x, level_offset_y + (int)n->y, (int)n->width, (int)n->height };
-        if (n->tex) {
-            if (n->hit_timer > 0) {
-                SDL_SetTextureColorMod(n->tex, 255, 100, 100);
-                SDL_RenderCopy(renderer, n->tex, NULL, &nd);
-                SDL_SetTextureColorMod(n->tex, 255,255,255);
-            } else SDL_RenderCopy(renderer, n->tex, NULL, &nd);
-        } else {
-            // draw fallback colored rect per id
-            char key[2] = { n->id, '\0' };
-            SDL_Texture* ft = cache_lookup(key);
-            if (!ft) {
-                ft = create_colored_texture_for_token(key, (int)n->width, (int)n->height);
-                if (ft) cache_insert(key, ft);
+        // no render-target support: draw the chunk's visible tiles straight from the atlas
+        int ra = vr0 > tr0 ? vr0 - tr0 : 0, rb = vr1 - tr0 < WORLD_CHUNK_TILES - 1 ? vr1 - tr0 : WORLD_CHUNK_TILES - 1;
+        int ca = vc0 > tc0 ? vc0 - tc0 : 0, cb = vc1 - tc0 < WORLD_CHUNK_TILES - 1 ? vc1 - tc0 : WORLD_CHUNK_TILES - 1;
+        for (int r = ra; r <= rb; ++r) {
+            for (int c = ca; c <= cb; ++c) {
+                uint16_t id = ch->tiles[r * WORLD_CHUNK_TILES + c];
+                if (id == TILE_NONE) continue;
+                batch_sprite(&token_sprites[id], camera_screen_x(&camera, (float)((tc0 + c) * TILE_SIZE)), camera_screen_y(&camera, (float)((tr0 + r) * TILE_SIZE)),
+                             TILE_SIZE * scale, TILE_SIZE * scale, no_tint);
             }
-            if (ft) SDL_RenderCopy(renderer, ft, NULL, &nd);
         }
     }
 
-    // damage popups
-    for (int pi = 0; pi < dmg_popup_count; ++pi) {
-        DmgPopup *p = &dmg_popups[pi];
+    prof_end(PROF_TILES);
+
+    prof_begin(PROF_ENTITIES);
+    // render NPCs: the grid finds the ones near the view (by center, so pad by a tile for
+    // their size and interpolation), drawn in slot order so overlaps don't depend on the grid
+    int *vis = npcs.scratch;
+    int vis_count = spatial_query_rect(&npc_grid, camera.x - TILE_SIZE, camera.y - TILE_SIZE,
+                                       camera.x + camera.view_w + TILE_SIZE, camera.y + camera.view_h + TILE_SIZE, vis, npcs.count);
+    qsort(vis, (size_t)vis_count, sizeof(int), cmp_int);
+    for (int k = 0; k < vis_count; ++k) {
+        int i = vis[k];
+        float draw_x = lerpf(npcs.prev_x[i], npcs.x[i], render_alpha), draw_y = lerpf(npcs.prev_y[i], npcs.y[i], render_alpha);
+        if (!camera_sees(&camera, draw_x, draw_y, npcs.width[i], npcs.height[i])) continue;
+        // missing entity images already got a colored fallback sprite when the token was interned
+        const Sprite *sp = npc_sprite(i);
+        SDL_Color tint = npcs.hit_timer[i] > 0 ? (SDL_Color){ 255, 100, 100, 255 } : no_tint;
+        batch_sprite(sp, camera_screen_x(&camera, draw_x), camera_screen_y(&camera, draw_y), npcs.width[i] * scale, npcs.height[i] * scale, tint);
+    }
+
+    // damage popups (text stays at its own size)
+    for (int pi = 0; pi < dmg_popups.count; ++pi) {
+        DmgPopup *p = pool_at(&dmg_popups, pi);
+        if (!camera_sees(&camera, p->x - 8, p->y, TILE_SIZE, TILE_SIZE)) continue;
         SDL_Color col = {255,220,160,255};
-        draw_text_ttf(level_offset_x + (int)p->x - 8, level_offset_y + (int)p->y, p->txt, col);
+        text_draw((int)camera_screen_x(&camera, p->x - 8), (int)camera_screen_y(&camera, p->y), p->txt, col);
     }
 
     // render drops on ground
-    for (int di = 0; di < drop_count; ++di) {
-        Drop *d = &drops[di];
-        if (!d->exists) continue;
-        SDL_Rect dd = { level_offset_x + (int)(d->x - TILE_SIZE/2), level_offset_y + (int)(d->y - TILE_SIZE/2), TILE_SIZE, TILE_SIZE };
-        SDL_Texture* dt = d->tex ? d->tex : ui_item_placeholder;
-        if (dt) SDL_RenderCopy(renderer, dt, NULL, &dd);
-    }
-
-    SDL_Rect dst = { level_offset_x + (int)player.x, level_offset_y + (int)player.y, (int)player.width, (int)player.height };
-
-    // choose texture by facing direction
-    SDL_Texture* use_tex = NULL;
-    switch (player_dir) {
-        case DIR_UP: use_tex = player_tex_up; break;
-        case DIR_LEFT: use_tex = player_tex_left; break;
-        case DIR_RIGHT: use_tex = player_tex_right; break;
-        case DIR_DOWN: default: use_tex = player_tex; break;
-    }
-    if (use_tex) {
-        if (player_hit_timer > 0) {
-            SDL_SetTextureColorMod(use_tex, 255, 120, 120);
-            SDL_RenderCopy(renderer, use_tex, NULL, &dst);
-            SDL_SetTextureColorMod(use_tex, 255,255,255);
-        } else SDL_RenderCopy(renderer, use_tex, NULL, &dst);
-    } else {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 255, 255);
-        SDL_RenderFillRect(renderer, &dst);
+    for (int di = 0; di < drops.count; ++di) {
+        const Drop *d = pool_at(&drops, di);
+        if (!camera_sees(&camera, d->x - TILE_SIZE/2, d->y - TILE_SIZE/2, TILE_SIZE, TILE_SIZE)) continue;
+        const Sprite *dt = d->sprite.tex ? &d->sprite : &ui_item_placeholder;
+        batch_sprite(dt, camera_screen_x(&camera, d->x - TILE_SIZE/2), camera_screen_y(&camera, d->y - TILE_SIZE/2), TILE_SIZE * scale, TILE_SIZE * scale, no_tint);
     }
 
+    SDL_Color player_tint = player_hit_timer > 0 ? (SDL_Color){ 255, 120, 120, 255 } : no_tint;
+    batch_sprite(player_sprite(), camera_screen_x(&camera, player_draw_x), camera_screen_y(&camera, player_draw_y),
+                 player.width * scale, player.height * scale, player_tint);
+
+    prof_end(PROF_ENTITIES);
+
+    // light map over the visible tiles, multiplied over the map and entities (not the UI)
+    if (light_active() && any_tiles) {
+        prof_begin(PROF_LIGHTING);
+        light_begin(vr0, vc0, vr1 - vr0 + 1, vc1 - vc0 + 1);
+        light_add(player_draw_x + player.width/2.0f, player_draw_y + player.height/2.0f, LIGHT_TORCH_RADIUS, (SDL_Color){ 255, 200, 140, 255 });
+        for (int di = 0; di < drops.count; ++di) {
+            const Drop *d = pool_at(&drops, di);
+            if (d->id[0] == 'C') light_add(d->x, d->y, LIGHT_CARD_RADIUS, (SDL_Color){ 120, 160, 255, 255 });
+        }
+        batch_flush();
+        light_draw(renderer, camera_screen_x(&camera, (float)(vc0 * TILE_SIZE)), camera_screen_y(&camera, (float)(vr0 * TILE_SIZE)), TILE_SIZE * scale);
+        prof_end(PROF_LIGHTING);
+    }
+
+    prof_begin(PROF_UI_PANEL);
     int ui_x = WINDOW_WIDTH - 340;
     int ui_y = 20;
     SDL_Rect panel = { ui_x, ui_y, 320, 440 };
-    SDL_SetRenderDrawColor(renderer, 24, 24, 28, 230);
-    SDL_RenderFillRect(renderer, &panel);
+    batch_rect(panel.x, panel.y, panel.w, panel.h, (SDL_Color){ 24, 24, 28, 230 });
     // outer border
-    SDL_SetRenderDrawColor(renderer, 60, 60, 70, 255);
-    SDL_Rect border = { ui_x, ui_y, panel.w, panel.h };
-    SDL_RenderDrawRect(renderer, &border);
+    SDL_Color border = { 60, 60, 70, 255 };
+    batch_rect(ui_x, ui_y, panel.w, 1, border);
+    batch_rect(ui_x, ui_y + panel.h - 1, panel.w, 1, border);
+    batch_rect(ui_x, ui_y, 1, panel.h, border);
+    batch_rect(ui_x + panel.w - 1, ui_y, 1, panel.h, border);
 
     // player portrait area (top-left of panel)
     SDL_Color white = { 230,230,230,255 };
     int pad = 12;
     int portrait_s = 80;
     SDL_Rect portrait = { ui_x + pad, ui_y + pad, portrait_s, portrait_s };
-    SDL_SetRenderDrawColor(renderer, 40, 40, 48, 255);
-    SDL_RenderFillRect(renderer, &portrait);
-    // draw player texture inside portrait (scaled to fit)
-    if (player_tex) {
-        SDL_RenderCopy(renderer, player_tex, NULL, &portrait);
-    } else if (fallback_player) {
-        SDL_RenderCopy(renderer, fallback_player, NULL, &portrait);
-    }
+    batch_rect(portrait.x, portrait.y, portrait.w, portrait.h, (SDL_Color){ 40, 40, 48, 255 });
+    // draw player sprite inside portrait (scaled to fit)
+    batch_sprite(anim_frame(&player_anim, ANIM_IDLE, DIR_DOWN, 0.0f),
+                 portrait.x, portrait.y, portrait.w, portrait.h, no_tint);
 
     // big HP bar to the right of portrait
     int hp_x = ui_x + pad + portrait_s + 12;
@@ -1162,48 +1862,33 @@ void render() {
     int hp_w = panel.w - (hp_x - ui_x) - pad;
     int hp_h = 22;
     // background
-    SDL_Rect hp_bg = { hp_x, hp_y, hp_w, hp_h };
-    SDL_SetRenderDrawColor(renderer, 50, 50, 60, 255);
-    SDL_RenderFillRect(renderer, &hp_bg);
+    batch_rect(hp_x, hp_y, hp_w, hp_h, (SDL_Color){ 50, 50, 60, 255 });
     // fill based on hp percentage
     float hp_pct = (player_max_hp > 0) ? ((float)player_hp / (float)player_max_hp) : 0.0f;
     if (hp_pct < 0) hp_pct = 0;
     if (hp_pct > 1) hp_pct = 1;
-    SDL_Rect hp_fill = { hp_x + 1, hp_y + 1, (int)((hp_w - 2) * hp_pct), hp_h - 2 };
-    SDL_SetRenderDrawColor(renderer, 180, 40, 40, 255);
-    SDL_RenderFillRect(renderer, &hp_fill);
+    batch_rect(hp_x + 1, hp_y + 1, (int)((hp_w - 2) * hp_pct), hp_h - 2, (SDL_Color){ 180, 40, 40, 255 });
     // HP numeric big
     char hpbuf[32]; snprintf(hpbuf, sizeof(hpbuf), "%d / %d", player_hp, player_max_hp);
     if (ui_font) {
-        SDL_Color col = {255,255,255,255};
-        SDL_Surface* surf = TTF_RenderText_Blended(ui_font, hpbuf, col);
-        if (surf) {
-            SDL_Texture* t = SDL_CreateTextureFromSurface(renderer, surf);
-            SDL_FreeSurface(surf);
-            if (t) {
-                int tw = 0, th = 0; SDL_QueryTexture(t, NULL, NULL, &tw, &th);
-                SDL_Rect tr = { hp_x + (hp_w - tw)/2, hp_y + (hp_h - th)/2, tw, th };
-                SDL_RenderCopy(renderer, t, NULL, &tr);
-                SDL_DestroyTexture(t);
-            }
-        }
+        int tw = 0, th = 0; text_size(hpbuf, &tw, &th);
+        text_draw(hp_x + (hp_w - tw)/2, hp_y + (hp_h - th)/2, hpbuf, (SDL_Color){255,255,255,255});
     } else {
-        draw_string_small(hp_x + 8, hp_y + 4, 3, white, hpbuf);
+        text_draw_small(hp_x + 8, hp_y + 4, 3, white, hpbuf);
     }
 
     // defense and level under the HP bar
     char defbuf[32]; snprintf(defbuf, sizeof(defbuf), "DEF: %d%%", player_defense_pct);
-    draw_text_ttf(hp_x, hp_y + hp_h + 8, defbuf, white);
+    text_draw(hp_x, hp_y + hp_h + 8, defbuf, white);
     char lvbuf[32]; snprintf(lvbuf, sizeof(lvbuf), "LVL: %d", player_level);
-    draw_text_ttf(hp_x + 110, hp_y + hp_h + 8, lvbuf, white);
+    text_draw(hp_x + 110, hp_y + hp_h + 8, lvbuf, white);
 
     // separator line
-    SDL_SetRenderDrawColor(renderer, 70,70,80,255);
     SDL_Rect sep = { ui_x + pad, ui_y + pad + portrait_s + 12, panel.w - pad*2, 2 };
-    SDL_RenderFillRect(renderer, &sep);
+    batch_rect(sep.x, sep.y, sep.w, sep.h, (SDL_Color){ 70,70,80,255 });
 
     // CARDS: spread across a single centered row with larger but fitting icons
-    draw_text_ttf(ui_x + pad, sep.y + 12, "CARDS", white);
+    text_draw(ui_x + pad, sep.y + 12, "CARDS", white);
     int cards_y = sep.y + 36;
     int card_w = 52;
     int card_gap = 8;
@@ -1212,28 +1897,20 @@ void render() {
     for (int i = 0; i < CARD_SLOTS; ++i) {
         int sx = start_x + i * (card_w + card_gap);
         int sy = cards_y;
-        SDL_Rect slot = { sx, sy, card_w, card_w };
-        if (ui_slot_tex) SDL_RenderCopy(renderer, ui_slot_tex, NULL, &slot);
+        batch_sprite(&ui_slot, sx, sy, card_w, card_w, no_tint);
         if (cardInv.slots[i].id[0] != '\0') {
-            SDL_Texture* itex = cardInv.slots[i].tex ? cardInv.slots[i].tex : ui_card_placeholder;
-            if (itex) SDL_RenderCopy(renderer, itex, NULL, &slot);
+            const Sprite* itex = cardInv.slots[i].sprite.tex ? &cardInv.slots[i].sprite : &ui_card_placeholder;
+            batch_sprite(itex, sx, sy, card_w, card_w, no_tint);
             // draw stack number small
             char sb[8]; snprintf(sb, sizeof(sb), "%d", cardInv.slots[i].stack);
-            if (ui_font) {
-                SDL_Color col = {255,255,255,255};
-                SDL_Surface* surf = TTF_RenderText_Blended(ui_font, sb, col);
-                if (surf) {
-                    SDL_Texture* t = SDL_CreateTextureFromSurface(renderer, surf);
-                    SDL_FreeSurface(surf);
-                    if (t) { SDL_Rect tr = { sx + card_w - 18, sy + card_w - 18, 16, 16 }; SDL_RenderCopy(renderer, t, NULL, &tr); SDL_DestroyTexture(t); }
-                }
-            } else draw_string_small(sx + card_w - 18, sy + card_w - 18, 2, white, sb);
+            if (ui_font) text_draw(sx + card_w - 18, sy + card_w - 18, sb, white);
+            else text_draw_small(sx + card_w - 18, sy + card_w - 18, 2, white, sb);
         }
     }
 
     // ITEMS: grid below cards
     int items_y = cards_y + card_w + 24;
-    draw_text_ttf(ui_x + pad, items_y, "ITEMS", white);
+    text_draw(ui_x + pad, items_y, "ITEMS", white);
     int grid_y = items_y + 20;
     int item_w = 48; int item_gap = 10; int cols = 5;
     for (int i = 0; i < OTHER_SLOTS; ++i) {
@@ -1241,90 +1918,238 @@ void render() {
         int col = i % cols;
         int sx = ui_x + pad + col * (item_w + item_gap);
         int sy = grid_y + row * (item_w + item_gap);
-        SDL_Rect slot = { sx, sy, item_w, item_w };
-        if (ui_slot_tex) SDL_RenderCopy(renderer, ui_slot_tex, NULL, &slot);
+        batch_sprite(&ui_slot, sx, sy, item_w, item_w, no_tint);
         if (otherInv.slots[i].id[0] != '\0') {
-            SDL_Texture* itex = otherInv.slots[i].tex ? otherInv.slots[i].tex : ui_item_placeholder;
-            if (itex) SDL_RenderCopy(renderer, itex, NULL, &slot);
+            const Sprite* itex = otherInv.slots[i].sprite.tex ? &otherInv.slots[i].sprite : &ui_item_placeholder;
+            batch_sprite(itex, sx, sy, item_w, item_w, no_tint);
             char sb[8]; snprintf(sb, sizeof(sb), "%d", otherInv.slots[i].stack);
-            if (ui_font) {
-                SDL_Color col = {255,255,255,255};
-                SDL_Surface* surf = TTF_RenderText_Blended(ui_font, sb, col);
-                if (surf) {
-                    SDL_Texture* t = SDL_CreateTextureFromSurface(renderer, surf);
-                    SDL_FreeSurface(surf);
-                    if (t) { SDL_Rect tr = { sx + item_w - 18, sy + item_w - 18, 16, 16 }; SDL_RenderCopy(renderer, t, NULL, &tr); SDL_DestroyTexture(t); }
-                }
-            } else draw_string_small(sx + item_w - 18, sy + item_w - 18, 2, white, sb);
+            if (ui_font) text_draw(sx + item_w - 18, sy + item_w - 18, sb, white);
+            else text_draw_small(sx + item_w - 18, sy + item_w - 18, 2, white, sb);
         }
     }
 
     // Game over overlay
     if (game_over) {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
-        SDL_Rect o = { 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT };
-        SDL_RenderFillRect(renderer, &o);
-        draw_string_small(WINDOW_WIDTH/2 - 20, WINDOW_HEIGHT/2 - 12, 4, (SDL_Color){255,50,50,255}, "GAME");
-        draw_string_small(WINDOW_WIDTH/2 + 12, WINDOW_HEIGHT/2 - 12, 4, (SDL_Color){255,50,50,255}, "OVER");
-        draw_string_small(WINDOW_WIDTH/2 - 24, WINDOW_HEIGHT/2 + 16, 2, white, "Press Enter to restart");
+        batch_rect(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, (SDL_Color){ 0, 0, 0, 200 });
+        text_draw_small(WINDOW_WIDTH/2 - 20, WINDOW_HEIGHT/2 - 12, 4, (SDL_Color){255,50,50,255}, "GAME");
+        text_draw_small(WINDOW_WIDTH/2 + 12, WINDOW_HEIGHT/2 - 12, 4, (SDL_Color){255,50,50,255}, "OVER");
+        text_draw_small(WINDOW_WIDTH/2 - 24, WINDOW_HEIGHT/2 + 16, 2, white, "Press Enter to restart");
     }
 
-    // HUD messages (top-center)
-    for (int hi = 0; hi < hud_count; ++hi) {
+    // HUD messages (top-center), oldest first; the pool itself is unordered
+    const HudMsg *hud_order[HUD_MSG_MAX];
+    for (int hi = 0; hi < hud_msgs.count; ++hi) {
+        const HudMsg *m = pool_at(&hud_msgs, hi);
+        int b = hi - 1;
+        while (b >= 0 && hud_order[b]->seq > m->seq) { hud_order[b+1] = hud_order[b]; b--; }
+        hud_order[b+1] = m;
+    }
+    for (int hi = 0; hi < hud_msgs.count; ++hi) {
         int sx = WINDOW_WIDTH/2 - 200/2;
         int sy = 10 + hi * 22;
         SDL_Color col = {255,255,200,255};
-        draw_text_ttf(sx, sy, hud_msgs[hi].text, col);
+        text_draw(sx, sy, hud_order[hi]->text, col);
+    }
+    prof_end(PROF_UI_PANEL);
+
+    if (show_profiler) {
+        prof_draw_overlay(10, WINDOW_HEIGHT - 300);
+        PacingStats ps;
+        pacing_stats(&ps);
+        char buf[96];
+        snprintf(buf, sizeof(buf), "%s %.2f ms, jitter %.2f (worst %.2f)", pacing_mode_name(pacing_mode()), ps.mean_ms, ps.jitter_ms, ps.worst_ms);
+        batch_rect(10.0f, (float)(WINDOW_HEIGHT - 322), 300.0f, 22.0f, (SDL_Color){ 0, 0, 0, 190 });
+        text_draw(14, WINDOW_HEIGHT - 320, buf, (SDL_Color){ 230, 230, 230, 255 });
     }
 
-    SDL_RenderPresent(renderer);
+    // queued quads are submitted here, so this includes the GPU submission of the batched phases
+    prof_begin(PROF_PRESENT);
+    batch_flush();
+    pacing_present(renderer);
+    prof_end(PROF_PRESENT);
 }
 
 void destroy_window() {
-    // destroy cached textures
-    for (int i = 0; i < texture_cache_count; ++i) {
-        if (texture_cache[i].tex) SDL_DestroyTexture(texture_cache[i].tex);
-    }
-    if (player_tex && player_tex != fallback_player) SDL_DestroyTexture(player_tex);
-    if (player_tex_up && player_tex_up != player_tex && player_tex_up != fallback_player) SDL_DestroyTexture(player_tex_up);
-    if (player_tex_right && player_tex_right != player_tex && player_tex_right != fallback_player) SDL_DestroyTexture(player_tex_right);
-    if (player_tex_left && player_tex_left != player_tex && player_tex_left != fallback_player) SDL_DestroyTexture(player_tex_left);
-    if (fallback_tile) SDL_DestroyTexture(fallback_tile);
-    if (fallback_entity) SDL_DestroyTexture(fallback_entity);
-    if (fallback_player) SDL_DestroyTexture(fallback_player);
-    if (ui_slot_tex) SDL_DestroyTexture(ui_slot_tex);
-    if (ui_card_placeholder) SDL_DestroyTexture(ui_card_placeholder);
-    if (ui_item_placeholder) SDL_DestroyTexture(ui_item_placeholder);
+    // every sprite lives in the atlas pages, so destroying those releases all textures
+    loader_finish(); // joins a level load still in flight
+    if (record_path && !replay_record_end()) fprintf(stderr, "Could not finish replay '%s'\n", record_path);
+    replay_close();
+    world_free();
+    level_free(&current_level);
+    text_shutdown();
+    atlas_destroy();
+    memset(token_sprites, 0, sizeof(token_sprites));
+    memset(entity_anim_ready, 0, sizeof(entity_anim_ready));
+    watch_shutdown();
+    light_free();
     if (ui_font) { TTF_CloseFont(ui_font); ui_font = NULL; }
-    // destroy NPC textures if they are unique and cached ones already destroyed
-    for (int i = 0; i < npc_count; ++i) {
-        if (npcs[i].tex) {
-            SDL_DestroyTexture(npcs[i].tex);
-            npcs[i].tex = NULL;
-        }
-    }
-    // destroy item textures
-    for (int i = 0; i < CARD_SLOTS; ++i) if (cardInv.slots[i].tex) SDL_DestroyTexture(cardInv.slots[i].tex);
-    for (int i = 0; i < OTHER_SLOTS; ++i) if (otherInv.slots[i].tex) SDL_DestroyTexture(otherInv.slots[i].tex);
-    for (int di = 0; di < drop_count; ++di) if (drops[di].tex) SDL_DestroyTexture(drops[di].tex);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    spatial_free(&npc_grid);
+    spatial_free(&drop_grid);
+    pool_free(&drops);
+    pool_free(&hud_msgs);
+    pool_free(&dmg_popups);
+    snapshot_ring_free(&rewind_ring);
+    snapshot_free(&level_start);
+    snapshot_free(&start_fresh);
+    snapshot_free(&start_next);
+    free(restore_spawns); restore_spawns = NULL; restore_spawn_cap = 0;
+    free(restore_heads); restore_heads = NULL; restore_head_cap = 0;
+    snapshot_free(&quick_save);
+    flow_free(&flow);
+    npc_free();
+    jobs_shutdown();
+    for (int w = 0; w < JOBS_MAX_WORKERS; ++w) { free(npc_attacks[w]); npc_attacks[w] = NULL; npc_attack_cap[w] = npc_attack_count[w] = 0; }
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (window) SDL_DestroyWindow(window);
     IMG_Quit();
     SDL_Quit();
 }
 
-int main() {
+#ifndef GAME_NO_MAIN
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            sim_tick_rate = atoi(argv[++i]);
+            if (sim_tick_rate < 1) sim_tick_rate = SIM_TICK_RATE;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+            // optional tick count right after the flag
+            if (i + 1 < argc && isdigit((unsigned char)argv[i+1][0])) headless_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            start_level = argv[++i];
+        } else if (strcmp(argv[i], "--debug-level") == 0) {
+            level_debug = 1;
+        } else if (strcmp(argv[i], "--compile-level") == 0 && i + 2 < argc) {
+            return compile_level(argv[i+1], argv[i+2]) ? 0 : 1;
+        } else if (strcmp(argv[i], "--residency") == 0 && i + 1 < argc) {
+            residency_radius = atoi(argv[++i]);
+            if (residency_radius < 0) residency_radius = 0;
+        } else if (strcmp(argv[i], "--max-npcs") == 0 && i + 1 < argc) {
+            max_npcs = atoi(argv[++i]);
+            if (max_npcs < 1) max_npcs = NPC_MAX_LIMIT;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            job_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) {
+            profile_trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            sim_seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+            seed_given = 1;
+        } else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc) {
+            if (!pacing_parse_mode(argv[++i], &pacing)) fprintf(stderr, "Unknown --pacing '%s' (vsync, capped, late-latch)\n", argv[i]);
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            pacing_fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-hot-reload") == 0) {
+            hot_reload = 0;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            // the recording decides everything the simulation depends on
+            const char* path = argv[++i];
+            ReplayHeader rh;
+            if (!replay_open(path, &rh)) {
+                fprintf(stderr, "Could not read replay '%s' (missing, or recorded by another version)\n", path);
+                return 1;
+            }
+            sim_seed = rh.seed; seed_given = 1;
+            sim_tick_rate = (int)rh.tick_rate;
+            residency_radius = (int)rh.residency_radius;
+            max_npcs = (int)rh.max_npcs;
+            memcpy(replay_level, rh.level, sizeof(replay_level));
+            start_level = replay_level;
+            replaying = 1;
+        }
+    }
+    if (sim_tick_rate < 1) sim_tick_rate = SIM_TICK_RATE;
+    if (!seed_given) sim_seed = (uint32_t)SDL_GetPerformanceCounter();
+    npc_seed(sim_seed);
+    if (record_path) {
+        ReplayHeader rh = { .seed = sim_seed, .tick_rate = (uint32_t)sim_tick_rate, .residency_radius = (uint32_t)residency_radius, .max_npcs = (uint32_t)max_npcs };
+        snprintf(rh.level, sizeof(rh.level), "%s", start_level);
+        if (!replay_record_begin(record_path, &rh)) {
+            fprintf(stderr, "Could not write replay '%s'\n", record_path);
+            record_path = NULL;
+        }
+    }
+
+    const float tick_dt = 1.0f / (float)sim_tick_rate;
+
+    if (headless) {
+        if (SDL_Init(SDL_INIT_TIMER) != 0) {
+            fprintf(stderr, "Error initializing SDL: %s\n", SDL_GetError());
+            return 1;
+        }
+        setup();
+        // timing every tick costs more than a headless tick itself: only profile when asked to
+        prof_init();
+        prof_set_enabled(profile_trace_path != NULL);
+        Uint64 start = SDL_GetPerformanceCounter();
+        // a replay runs for as long as the recording does
+        int ticks = 0;
+        while (replaying || ticks < headless_ticks) {
+            // one profiler frame per tick (only recorded with --profile-trace)
+            prof_frame_begin();
+            prof_begin(PROF_LEVEL_LOAD);
+            if (!replaying && poll_level_loader()) level_swap_flag = REPLAY_LEVEL_SWAP;
+            prof_end(PROF_LEVEL_LOAD);
+            prof_begin(PROF_UPDATE); int ran = sim_tick(tick_dt, 0); prof_end(PROF_UPDATE);
+            prof_frame_end();
+            if (!ran) break;
+            ticks++;
+        }
+        double secs = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+        fprintf(stdout, "headless: %d ticks in %.3f s (%.0f ticks/sec, %d NPCs left)\n",
+                ticks, secs, secs > 0 ? ticks / secs : 0.0, npcs.count);
+        if (profile_trace_path && !prof_write_trace(profile_trace_path)) fprintf(stderr, "Could not write %s\n", profile_trace_path);
+        destroy_window();
+        return replay_failed ? 1 : 0;
+    }
+
     game_is_running = initialize_window();
 
     setup();
+    start_hot_reload();
+    prof_init();
 
+    float accumulator = 0.0f;
     while (game_is_running) {
+        // waits for the frame's start (capped and late-latch), so input is read right after
+        float frame_time = (float)pacing_frame_begin();
+        // cap catch-up: after a long stall drop the excess instead of running dozens of ticks
+        if (frame_time > tick_dt * MAX_SIM_STEPS_PER_FRAME) frame_time = tick_dt * MAX_SIM_STEPS_PER_FRAME;
+        accumulator += frame_time;
+
+        prof_frame_begin();
+        prof_begin(PROF_INPUT);
         process_input();
-        update();
+        prof_end(PROF_INPUT);
+        // key events are stamped in SDL ms; everything drained above is at or before this
+        Uint32 now = SDL_GetTicks();
+        // level swaps happen here, between ticks, never in the middle of one
+        // (a replay swaps levels on the tick the recording did instead)
+        prof_begin(PROF_LEVEL_LOAD);
+        if (!replaying && poll_level_loader()) level_swap_flag = REPLAY_LEVEL_SWAP;
+        poll_hot_reload();
+        prof_end(PROF_LEVEL_LOAD);
+        while (accumulator >= tick_dt) {
+            accumulator -= tick_dt;
+            // the tick covers simulated time up to `now` minus what is still left over; it takes
+            // the key actions that happened before that, later ones wait for the next tick
+            prof_begin(PROF_UPDATE);
+            sim_tick(tick_dt, now - (Uint32)(accumulator * 1000.0f));
+            prof_end(PROF_UPDATE);
+        }
+        render_alpha = accumulator / tick_dt;
         render();
+        prof_frame_end();
     }
 
+    if (profile_trace_path && !prof_write_trace(profile_trace_path)) fprintf(stderr, "Could not write %s\n", profile_trace_path);
+    PacingStats ps;
+    pacing_stats(&ps);
+    fprintf(stdout, "pacing: %s, %.2f ms/frame, jitter %.2f ms (worst %.2f ms) over the last %d frames\n",
+            pacing_mode_name(pacing_mode()), ps.mean_ms, ps.jitter_ms, ps.worst_ms, ps.frames);
     destroy_window();
 
     return 0;
 }
+#endif
@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./constants.h"
+#include "./npc.h"
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+NpcStore npcs;
+NpcCold* npc_cold = NULL;
+
+// handle table: generation per handle slot, and either the dense slot (live) or the next
+// free handle slot (free list)
+static uint32_t* handle_gen = NULL;
+static int* handle_dense = NULL;
+static int handle_capacity = 0;
+static int handle_used = 1; // handle slot 0 is never used so NPC_HANDLE_NONE stays invalid
+static int handle_free = -1;
+static uint32_t spawn_seed = 0; // seeds NPC random states in spawn order
+
+#define GROW(ptr, n) do { void* p_ = realloc((ptr), sizeof(*(ptr)) * (size_t)(n)); if (!p_) return FALSE; (ptr) = p_; } while (0)
+
+int npc_reserve(int capacity) {
+    if (capacity <= npcs.capacity) return TRUE;
+    if (capacity > npcs.limit) capacity = npcs.limit;
+    if (capacity <= npcs.capacity) return FALSE;
+    GROW(npcs.x, capacity); GROW(npcs.y, capacity);
+    GROW(npcs.vx, capacity); GROW(npcs.vy, capacity);
+    GROW(npcs.prev_x, capacity); GROW(npcs.prev_y, capacity);
+    GROW(npcs.width, capacity); GROW(npcs.height, capacity);
+    GROW(npcs.speed, capacity);
+    GROW(npcs.wander_timer, capacity); GROW(npcs.attack_cooldown, capacity); GROW(npcs.hit_timer, capacity);
+    GROW(npcs.hp, capacity);
+    GROW(npcs.hostile, capacity);
+    GROW(npcs.rng, capacity);
+    GROW(npcs.handle, capacity);
+    GROW(npcs.scratch, capacity);
+    GROW(npc_cold, capacity);
+    // one live handle per NPC, plus slot 0
+    GROW(handle_gen, capacity + 1);
+    GROW(handle_dense, capacity + 1);
+    for (int i = handle_capacity; i < capacity + 1; ++i) { handle_gen[i] = 1; handle_dense[i] = -1; }
+    handle_capacity = capacity + 1;
+    npcs.capacity = capacity;
+    return TRUE;
+}
+
+int npc_init(int initial_capacity, int limit) {
+    npc_free();
+    if (limit > (int)NPC_HANDLE_INDEX_MASK) limit = (int)NPC_HANDLE_INDEX_MASK;
+    npcs.limit = limit;
+    return npc_reserve(initial_capacity < limit ? initial_capacity : limit);
+}
+
+void npc_free(void) {
+    free(npcs.x); free(npcs.y); free(npcs.vx); free(npcs.vy); free(npcs.prev_x); free(npcs.prev_y);
+    free(npcs.width); free(npcs.height); free(npcs.speed);
+    free(npcs.wander_timer); free(npcs.attack_cooldown); free(npcs.hit_timer);
+    free(npcs.hp); free(npcs.hostile); free(npcs.rng); free(npcs.handle);
+    free(npcs.scratch);
+    free(npc_cold); npc_cold = NULL;
+    free(handle_gen); handle_gen = NULL;
+    free(handle_dense); handle_dense = NULL;
+    handle_capacity = 0; handle_used = 1; handle_free = -1;
+    int limit = npcs.limit;
+    memset(&npcs, 0, sizeof(npcs));
+    npcs.limit = limit;
+}
+
+void npc_clear(void) {
+    // bump the generation of every handle that was handed out so stale ones stop resolving
+    for (int i = 1; i < handle_used; ++i) {
+        handle_gen[i] = (handle_gen[i] + 1) & (0xFFFFFFFFu >> NPC_HANDLE_INDEX_BITS);
+        if (handle_gen[i] == 0) handle_gen[i] = 1;
+        handle_dense[i] = -1;
+    }
+    handle_used = 1; handle_free = -1;
+    npcs.count = 0;
+}
+
+static NpcHandle alloc_handle(int dense) {
+    int hi;
+    if (handle_free >= 0) { hi = handle_free; handle_free = handle_dense[hi]; }
+    else hi = handle_used++;
+    handle_dense[hi] = dense;
+    return ((NpcHandle)handle_gen[hi] << NPC_HANDLE_INDEX_BITS) | (NpcHandle)hi;
+}
+
+static void release_handle(NpcHandle h) {
+    int hi = (int)(h & NPC_HANDLE_INDEX_MASK);
+    handle_gen[hi] = (handle_gen[hi] + 1) & (0xFFFFFFFFu >> NPC_HANDLE_INDEX_BITS);
+    if (handle_gen[hi] == 0) handle_gen[hi] = 1;
+    handle_dense[hi] = handle_free;
+    handle_free = hi;
+}
+
+void npc_seed(uint32_t seed) { spawn_seed = seed; }
+
+uint32_t npc_seed_state(void) { return spawn_seed; }
+
+int npc_spawn(void) {
+    if (npcs.count >= npcs.capacity) {
+        int want = npcs.capacity ? npcs.capacity * 2 : MAX_NPCS;
+        if (!npc_reserve(want)) return -1;
+    }
+    int i = npcs.count++;
+    npcs.x[i] = npcs.y[i] = npcs.vx[i] = npcs.vy[i] = 0.0f;
+    npcs.prev_x[i] = npcs.prev_y[i] = 0.0f;
+    npcs.width[i] = npcs.height[i] = npcs.speed[i] = 0.0f;
+    npcs.wander_timer[i] = npcs.attack_cooldown[i] = npcs.hit_timer[i] = 0.0f;
+    npcs.hp[i] = 0; npcs.hostile[i] = 0;
+    // golden-ratio steps give well spread, never-zero seeds
+    spawn_seed += 0x9E3779B9u;
+    npcs.rng[i] = spawn_seed ? spawn_seed : 1u;
+    memset(&npc_cold[i], 0, sizeof(npc_cold[i]));
+    npc_cold[i].spawn = -1;
+    npcs.handle[i] = alloc_handle(i);
+    return i;
+}
+
+int npc_spawn_block(int count) {
+    if (count < 0 || (npcs.count + count > npcs.capacity && !npc_reserve(npcs.count + count)) || npcs.count + count > npcs.capacity) return -1;
+    int first = npcs.count;
+    for (int i = first; i < first + count; ++i) npcs.handle[i] = alloc_handle(i);
+    npcs.count += count;
+    return first;
+}
+
+// copy every field of slot `from` into slot `to`
+static void move_slot(int from, int to) {
+    npcs.x[to] = npcs.x[from]; npcs.y[to] = npcs.y[from];
+    npcs.vx[to] = npcs.vx[from]; npcs.vy[to] = npcs.vy[from];
+    npcs.prev_x[to] = npcs.prev_x[from]; npcs.prev_y[to] = npcs.prev_y[from];
+    npcs.width[to] = npcs.width[from]; npcs.height[to] = npcs.height[from];
+    npcs.speed[to] = npcs.speed[from];
+    npcs.wander_timer[to] = npcs.wander_timer[from];
+    npcs.attack_cooldown[to] = npcs.attack_cooldown[from];
+    npcs.hit_timer[to] = npcs.hit_timer[from];
+    npcs.hp[to] = npcs.hp[from]; npcs.hostile[to] = npcs.hostile[from];
+    npcs.rng[to] = npcs.rng[from];
+    npcs.handle[to] = npcs.handle[from];
+    npc_cold[to] = npc_cold[from];
+    handle_dense[npcs.handle[to] & NPC_HANDLE_INDEX_MASK] = to;
+}
+
+int npc_remove(int slot) {
+    if (slot < 0 || slot >= npcs.count) return -1;
+    release_handle(npcs.handle[slot]);
+    int last = --npcs.count;
+    if (slot == last) return -1;
+    move_slot(last, slot);
+    return last;
+}
+
+int npc_slot(NpcHandle h) {
+    int hi = (int)(h & NPC_HANDLE_INDEX_MASK);
+    if (hi <= 0 || hi >= handle_used) return -1;
+    if (handle_gen[hi] != (h >> NPC_HANDLE_INDEX_BITS)) return -1;
+    return handle_dense[hi];
+}
+
+// count down a timer array, leaving timers that already ran out untouched
+static void tick_timer_array(float* restrict t, int n, float dt) {
+    int i = 0;
+#if defined(__SSE__)
+    const __m128 vdt = _mm_set1_ps(dt), zero = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(t + i);
+        __m128 active = _mm_cmpgt_ps(v, zero);
+        v = _mm_sub_ps(v, _mm_and_ps(active, vdt));
+        _mm_storeu_ps(t + i, v);
+    }
+#endif
+    for (; i < n; ++i) if (t[i] > 0) t[i] -= dt;
+}
+
+void npc_tick_timers(int begin, int end, float dt) {
+    tick_timer_array(npcs.wander_timer + begin, end - begin, dt);
+    tick_timer_array(npcs.attack_cooldown + begin, end - begin, dt);
+    tick_timer_array(npcs.hit_timer + begin, end - begin, dt);
+}
+
+void npc_damp_and_clamp(int begin, int end, float damping, float max_x, float max_y) {
+    const int n = end - begin;
+    float* restrict x = npcs.x + begin; float* restrict y = npcs.y + begin;
+    float* restrict vx = npcs.vx + begin; float* restrict vy = npcs.vy + begin;
+    const float* restrict w = npcs.width + begin; const float* restrict h = npcs.height + begin;
+    int i = 0;
+#if defined(__SSE__)
+    const __m128 vd = _mm_set1_ps(damping), zero = _mm_setzero_ps();
+    const __m128 mx = _mm_set1_ps(max_x), my = _mm_set1_ps(max_y);
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(vx + i, _mm_mul_ps(_mm_loadu_ps(vx + i), vd));
+        _mm_storeu_ps(vy + i, _mm_mul_ps(_mm_loadu_ps(vy + i), vd));
+        // x = min(max(x, 0), max_x - w): same result as clamping low then high
+        __m128 px = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(x + i), zero), _mm_sub_ps(mx, _mm_loadu_ps(w + i)));
+        __m128 py = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(y + i), zero), _mm_sub_ps(my, _mm_loadu_ps(h + i)));
+        _mm_storeu_ps(x + i, px);
+        _mm_storeu_ps(y + i, py);
+    }
+#endif
+    for (; i < n; ++i) {
+        vx[i] *= damping; vy[i] *= damping;
+        if (x[i] < 0) x[i] = 0;
+        if (y[i] < 0) y[i] = 0;
+        if (x[i] > max_x - w[i]) x[i] = max_x - w[i];
+        if (y[i] > max_y - h[i]) y[i] = max_y - h[i];
+    }
+}
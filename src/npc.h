@@ -0,0 +1,80 @@
+#ifndef NPC_H
+#define NPC_H
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "./anim.h"
+
+// a stable reference to an NPC: slot in the handle table (low bits) + generation (high bits).
+// Dense slots move when NPCs are removed; handles stay valid until that NPC is removed.
+typedef uint32_t NpcHandle;
+#define NPC_HANDLE_NONE 0u
+#define NPC_HANDLE_INDEX_BITS 20
+#define NPC_HANDLE_INDEX_MASK ((1u << NPC_HANDLE_INDEX_BITS) - 1u)
+
+// hot per-tick NPC data: one array per field, indexed by dense slot 0..count-1
+typedef struct {
+    int count;
+    int capacity;
+    int limit; // capacity never grows past this (--max-npcs)
+    float *x, *y;
+    float *vx, *vy;
+    float *prev_x, *prev_y; // position at the start of the tick (interpolation)
+    float *width, *height;
+    float *speed;
+    float *wander_timer, *attack_cooldown, *hit_timer;
+    int *hp;
+    uint8_t *hostile; // 0 = neutral, 1 = hostile
+    uint32_t *rng;    // per-NPC random state, so AI results don't depend on update order
+    NpcHandle *handle;
+    // per-slot scratch for queries
+    int *scratch;
+} NpcStore;
+
+// cold NPC data: touched on spawn, interaction, death and draw only
+typedef struct {
+    char id; /* letter */
+    int spawn; /* level spawn record (world.spawns), -1 = none */
+    const AnimSheet* anim; /* shared per letter */
+    int max_hp;
+    char drop_id[8];
+    int level_on_kill; /* how many levels to gain on kill */
+    char dialog[128];
+} NpcCold;
+
+extern NpcStore npcs;
+extern NpcCold* npc_cold;
+
+int npc_init(int initial_capacity, int limit);
+void npc_free(void);
+// make room for at least capacity NPCs (up to the limit)
+int npc_reserve(int capacity);
+// remove every NPC and invalidate all handles
+void npc_clear(void);
+// restart the sequence NPC random states are seeded from (replays record this seed)
+void npc_seed(uint32_t seed);
+// where that sequence is now (snapshots save it and hand it back to npc_seed)
+uint32_t npc_seed_state(void);
+// append an NPC with zeroed fields; returns its dense slot or -1 when the limit is reached
+int npc_spawn(void);
+// append count NPCs for a snapshot restore: fresh handles, but no draws from the seed sequence
+// and no clearing; hot and cold data are whatever the slots held before, for the caller to set.
+// Returns the first slot, -1 past the limit.
+int npc_spawn_block(int count);
+// swap-and-pop removal; returns the old slot of the NPC moved into `slot`, or -1 if none moved
+int npc_remove(int slot);
+// dense slot for a handle, -1 if that NPC no longer exists
+int npc_slot(NpcHandle h);
+
+// batch kernels over the NPCs in [begin, end) (SSE when available, scalar otherwise)
+void npc_tick_timers(int begin, int end, float dt);
+void npc_damp_and_clamp(int begin, int end, float damping, float max_x, float max_y);
+
+// next value of an NPC's random sequence (xorshift32)
+static inline uint32_t npc_rand(int i) {
+    uint32_t x = npcs.rng[i];
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return npcs.rng[i] = x;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include <math.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./pacing.h"
+
+static PacingMode mode = PACING_VSYNC;
+static double freq = 0.0;        // performance counter ticks per second
+static Uint64 period = 0;        // counter ticks per frame
+static Uint64 frame_start = 0;   // when the current frame started (after any wait)
+static Uint64 next_start = 0;    // capped: when the next frame is due
+static Uint64 present_done = 0;  // late-latch: when the last present returned
+static Uint64 work[PACING_LATCH_FRAMES]; // late-latch: frame start to present, recent frames
+static int work_pos = 0;
+static float intervals[PACING_HISTORY]; // ms between frame starts, ring buffer
+static int interval_pos = 0, interval_count = 0;
+
+int pacing_parse_mode(const char* name, PacingMode* out) {
+    if (strcmp(name, "vsync") == 0) *out = PACING_VSYNC;
+    else if (strcmp(name, "capped") == 0) *out = PACING_CAPPED;
+    else if (strcmp(name, "late-latch") == 0) *out = PACING_LATE_LATCH;
+    else return FALSE;
+    return TRUE;
+}
+
+const char* pacing_mode_name(PacingMode m) {
+    return m == PACING_CAPPED ? "capped" : m == PACING_LATE_LATCH ? "late-latch" : "vsync";
+}
+
+void pacing_init(PacingMode m, int fps) {
+    mode = m;
+    freq = (double)SDL_GetPerformanceFrequency();
+    period = (Uint64)(freq / (fps > 0 ? fps : PACING_DEFAULT_FPS));
+    frame_start = next_start = present_done = 0;
+    memset(work, 0, sizeof(work));
+    work_pos = interval_pos = interval_count = 0;
+}
+
+PacingMode pacing_mode(void) { return mode; }
+
+int pacing_vsync(void) { return mode != PACING_CAPPED; }
+
+// sleep while the deadline is more than PACING_SPIN_MS away, then spin on the counter:
+// SDL_Delay alone can overshoot by a millisecond or more
+static void wait_until(Uint64 deadline) {
+    Uint64 spin = (Uint64)(freq * PACING_SPIN_MS / 1000.0);
+    for (;;) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= deadline) return;
+        if (deadline - now > spin) SDL_Delay((Uint32)((double)(deadline - now - spin) * 1000.0 / freq));
+    }
+}
+
+double pacing_frame_begin(void) {
+    if (freq == 0.0) pacing_init(mode, 0);
+    if (mode == PACING_CAPPED && next_start) {
+        // behind by more than a frame (a stall): start counting again from now rather than
+        // running a burst of unpaced frames to catch up
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now > next_start + period) next_start = now;
+        wait_until(next_start);
+    } else if (mode == PACING_LATE_LATCH && present_done) {
+        Uint64 worst = 0;
+        for (int i = 0; i < PACING_LATCH_FRAMES; ++i) if (work[i] > worst) worst = work[i];
+        Uint64 need = worst + (Uint64)(freq * PACING_LATCH_MARGIN_MS / 1000.0);
+        // no waiting if the work alone takes a whole refresh
+        if (need < period) wait_until(present_done + period - need);
+    }
+    Uint64 now = SDL_GetPerformanceCounter();
+    double dt = frame_start ? (double)(now - frame_start) / freq : 0.0;
+    if (frame_start) {
+        intervals[interval_pos] = (float)(dt * 1000.0);
+        interval_pos = (interval_pos + 1) % PACING_HISTORY;
+        if (interval_count < PACING_HISTORY) interval_count++;
+    }
+    frame_start = now;
+    next_start = (next_start ? next_start : now) + period;
+    return dt;
+}
+
+void pacing_present(SDL_Renderer* renderer) {
+    Uint64 before = SDL_GetPerformanceCounter();
+    SDL_RenderPresent(renderer);
+    present_done = SDL_GetPerformanceCounter();
+    if (frame_start) {
+        work[work_pos] = before - frame_start;
+        work_pos = (work_pos + 1) % PACING_LATCH_FRAMES;
+    }
+}
+
+void pacing_stats(PacingStats* out) {
+    memset(out, 0, sizeof(*out));
+    out->frames = interval_count;
+    if (interval_count == 0) return;
+    double sum = 0.0, sq = 0.0;
+    for (int i = 0; i < interval_count; ++i) sum += intervals[i];
+    double mean = sum / interval_count;
+    float worst = 0.0f;
+    for (int i = 0; i < interval_count; ++i) {
+        double d = intervals[i] - mean;
+        sq += d * d;
+        if (fabs(d) > worst) worst = (float)fabs(d);
+    }
+    out->mean_ms = (float)mean;
+    out->jitter_ms = (float)sqrt(sq / interval_count);
+    out->worst_ms = worst;
+}
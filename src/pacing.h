@@ -0,0 +1,37 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <SDL2/SDL.h>
+
+// Frame pacing on SDL_GetPerformanceCounter.
+//  vsync:      SDL_RenderPresent blocks until the display's refresh; nothing else waits
+//  capped:     no vsync; each frame starts on a fixed period, sleeping most of the wait and
+//              spinning the last PACING_SPIN_MS for precision
+//  late-latch: vsync, but after a present the next frame is held back until just enough
+//              time is left for its work (the slowest of the recent frames), so input is
+//              read as close to the refresh it is shown on as possible
+// Frame-start intervals are kept for jitter stats.
+typedef enum { PACING_VSYNC, PACING_CAPPED, PACING_LATE_LATCH } PacingMode;
+
+typedef struct {
+    int frames;      // intervals measured (at most PACING_HISTORY)
+    float mean_ms;   // average frame interval
+    float jitter_ms; // standard deviation of the interval
+    float worst_ms;  // largest distance of one interval from the mean
+} PacingStats;
+
+// "vsync", "capped", "late-latch"; FALSE for anything else
+int pacing_parse_mode(const char* name, PacingMode* mode);
+const char* pacing_mode_name(PacingMode mode);
+// fps is the cap, or the display's refresh rate for the vsync modes; clears the stats
+void pacing_init(PacingMode mode, int fps);
+PacingMode pacing_mode(void);
+// whether the renderer should be created with SDL_RENDERER_PRESENTVSYNC
+int pacing_vsync(void);
+// wait until the next frame should start; seconds since the previous frame started
+double pacing_frame_begin(void);
+// SDL_RenderPresent, timed so late-latch knows how long a frame's work takes
+void pacing_present(SDL_Renderer* renderer);
+void pacing_stats(PacingStats* out);
+
+#endif
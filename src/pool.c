@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./constants.h"
+#include "./pool.h"
+
+#define GEN_MASK (0xFFFFFFFFu >> POOL_HANDLE_INDEX_BITS)
+
+// handle slot 0 is never used, so POOL_HANDLE_NONE never resolves
+static void link_free_list(Pool* p) {
+    for (int i = 1; i <= p->capacity; ++i) p->dense[i] = i < p->capacity ? i + 1 : -1;
+    p->free_head = p->capacity > 0 ? 1 : -1;
+}
+
+int pool_init(Pool* p, int capacity, size_t item_size) {
+    memset(p, 0, sizeof(*p));
+    if (capacity < 1 || capacity > (int)POOL_HANDLE_INDEX_MASK || item_size == 0) return FALSE;
+    p->items = calloc((size_t)capacity, item_size);
+    p->handle = calloc((size_t)capacity, sizeof(PoolHandle));
+    p->gen = calloc((size_t)capacity + 1, sizeof(uint32_t));
+    p->dense = calloc((size_t)capacity + 1, sizeof(int));
+    if (!p->items || !p->handle || !p->gen || !p->dense) { pool_free(p); return FALSE; }
+    p->item_size = item_size;
+    p->capacity = capacity;
+    for (int i = 0; i <= capacity; ++i) p->gen[i] = 1;
+    link_free_list(p);
+    return TRUE;
+}
+
+void pool_free(Pool* p) {
+    free(p->items); free(p->handle); free(p->gen); free(p->dense);
+    memset(p, 0, sizeof(*p));
+    p->free_head = -1;
+}
+
+static void bump_gen(Pool* p, int hi) {
+    p->gen[hi] = (p->gen[hi] + 1) & GEN_MASK;
+    if (p->gen[hi] == 0) p->gen[hi] = 1;
+}
+
+void pool_clear(Pool* p) {
+    for (int i = 0; i < p->count; ++i) bump_gen(p, (int)(p->handle[i] & POOL_HANDLE_INDEX_MASK));
+    p->count = 0;
+    if (p->dense) link_free_list(p);
+}
+
+int pool_add(Pool* p) {
+    if (p->count >= p->capacity || p->free_head < 0) return -1;
+    int hi = p->free_head;
+    p->free_head = p->dense[hi];
+    int slot = p->count++;
+    p->dense[hi] = slot;
+    p->handle[slot] = ((PoolHandle)p->gen[hi] << POOL_HANDLE_INDEX_BITS) | (PoolHandle)hi;
+    memset(pool_at(p, slot), 0, p->item_size);
+    return slot;
+}
+
+int pool_remove(Pool* p, int slot) {
+    if (slot < 0 || slot >= p->count) return -1;
+    int hi = (int)(p->handle[slot] & POOL_HANDLE_INDEX_MASK);
+    bump_gen(p, hi);
+    p->dense[hi] = p->free_head;
+    p->free_head = hi;
+    int last = --p->count;
+    if (slot == last) return -1;
+    memcpy(pool_at(p, slot), pool_at(p, last), p->item_size);
+    p->handle[slot] = p->handle[last];
+    p->dense[p->handle[slot] & POOL_HANDLE_INDEX_MASK] = slot;
+    return last;
+}
+
+int pool_slot(const Pool* p, PoolHandle h) {
+    int hi = (int)(h & POOL_HANDLE_INDEX_MASK);
+    if (hi <= 0 || hi > p->capacity || p->gen[hi] != (h >> POOL_HANDLE_INDEX_BITS)) return -1;
+    int slot = p->dense[hi];
+    return slot >= 0 && slot < p->count && p->handle[slot] == h ? slot : -1;
+}
@@ -0,0 +1,43 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// fixed-capacity pool of same-sized items. Live items are packed at the front (dense slots
+// 0..count-1, in no particular order), so updating or drawing them is a plain loop. Removal
+// swaps the last item into the hole, so adding and removing are O(1) and no slot is ever
+// lost. Items that need to be referred to later are named by handles: slot in a handle table
+// (low bits) + generation (high bits). A handle follows its item when it moves and stops
+// resolving once the item is removed.
+typedef uint32_t PoolHandle;
+#define POOL_HANDLE_NONE 0u
+#define POOL_HANDLE_INDEX_BITS 16
+#define POOL_HANDLE_INDEX_MASK ((1u << POOL_HANDLE_INDEX_BITS) - 1u)
+
+typedef struct {
+    unsigned char* items; // capacity items of item_size bytes; dense slots 0..count-1 are live
+    size_t item_size;
+    int count, capacity;
+    PoolHandle* handle;   // per dense slot: the item's handle
+    uint32_t* gen;        // per handle slot 1..capacity: current generation
+    int* dense;           // per handle slot: dense slot when live, else the next free handle slot
+    int free_head;
+} Pool;
+
+// capacity is at most POOL_HANDLE_INDEX_MASK
+int pool_init(Pool* p, int capacity, size_t item_size);
+void pool_free(Pool* p);
+// remove every item; all handles handed out so far go stale
+void pool_clear(Pool* p);
+// add a zeroed item; returns its dense slot (count - 1), or -1 when the pool is full
+int pool_add(Pool* p);
+// remove the item at a dense slot. Returns the old slot of the item that was moved into it,
+// or -1 if none was (the removed item was last)
+int pool_remove(Pool* p, int slot);
+// dense slot of a handle's item, -1 if it was removed
+int pool_slot(const Pool* p, PoolHandle h);
+
+static inline void* pool_at(const Pool* p, int slot) { return p->items + (size_t)slot * p->item_size; }
+
+#endif
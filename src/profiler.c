@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./batch.h"
+#include "./text.h"
+#include "./profiler.h"
+
+static const char* phase_names[PROF_PHASE_COUNT] = {
+    "frame", "input", "level_load", "update", "npc_ai", "pickup", "tiles", "entities", "lighting", "ui_panel", "present"
+};
+
+typedef struct {
+    int phase;
+    Uint64 start, end;
+} ProfEvent;
+
+typedef struct {
+    Uint64 start, end;
+    float phase_ms[PROF_PHASE_COUNT]; // summed over every scope of the phase in this frame
+    ProfEvent events[PROFILER_MAX_EVENTS];
+    int event_count; // scopes past PROFILER_MAX_EVENTS only count toward phase_ms
+} ProfFrame;
+
+static ProfFrame frames[PROFILER_HISTORY];
+static int frame_head = 0;  // slot of the frame being recorded
+static int frame_total = 0; // completed frames in the ring, at most PROFILER_HISTORY
+static int recording = 0;   // between prof_frame_begin and prof_frame_end
+static int enabled = 1;
+static struct { int phase; Uint64 start; } stack[PROFILER_MAX_DEPTH];
+static int depth = 0;
+static Uint64 origin = 0;
+static double ms_per_count = 0.0;
+
+void prof_init(void) {
+    origin = SDL_GetPerformanceCounter();
+    ms_per_count = 1000.0 / (double)SDL_GetPerformanceFrequency();
+    frame_head = frame_total = 0;
+    recording = depth = 0;
+}
+
+void prof_set_enabled(int on) {
+    enabled = on;
+    if (!on) recording = 0;
+}
+
+int prof_enabled(void) { return enabled; }
+
+void prof_begin(int phase) {
+    if (!recording) return;
+    if (depth < PROFILER_MAX_DEPTH) { stack[depth].phase = phase; stack[depth].start = SDL_GetPerformanceCounter(); }
+    depth++;
+}
+
+void prof_end(int phase) {
+    if (!recording || depth == 0) return;
+    depth--;
+    if (depth >= PROFILER_MAX_DEPTH || stack[depth].phase != phase) return;
+    Uint64 now = SDL_GetPerformanceCounter();
+    ProfFrame* f = &frames[frame_head];
+    f->phase_ms[phase] += (float)((double)(now - stack[depth].start) * ms_per_count);
+    // the frame scope itself is stored in start/end
+    if (phase == PROF_FRAME || f->event_count >= PROFILER_MAX_EVENTS) return;
+    ProfEvent* e = &f->events[f->event_count++];
+    e->phase = phase;
+    e->start = stack[depth].start; e->end = now;
+}
+
+void prof_frame_begin(void) {
+    if (!enabled) return;
+    ProfFrame* f = &frames[frame_head];
+    memset(f->phase_ms, 0, sizeof(f->phase_ms));
+    f->event_count = 0;
+    f->start = SDL_GetPerformanceCounter();
+    recording = 1;
+    depth = 0;
+    prof_begin(PROF_FRAME);
+}
+
+void prof_frame_end(void) {
+    if (!recording) return;
+    // close anything left open so the frame scope is the one that ends
+    depth = 1;
+    prof_end(PROF_FRAME);
+    frames[frame_head].end = SDL_GetPerformanceCounter();
+    frame_head = (frame_head + 1) % PROFILER_HISTORY;
+    if (frame_total < PROFILER_HISTORY) frame_total++;
+    recording = 0;
+}
+
+// i-th completed frame, oldest first
+static const ProfFrame* frame_at(int i) {
+    int first = frame_total < PROFILER_HISTORY ? 0 : frame_head;
+    return &frames[(first + i) % PROFILER_HISTORY];
+}
+
+static double to_us(Uint64 t) { return (double)(t - origin) * ms_per_count * 1000.0; }
+
+int prof_write_trace(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return FALSE;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}");
+    for (int i = 0; i < frame_total; ++i) {
+        const ProfFrame* fr = frame_at(i);
+        fprintf(f, ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                to_us(fr->start), to_us(fr->end) - to_us(fr->start));
+        for (int k = 0; k < fr->event_count; ++k) {
+            const ProfEvent* e = &fr->events[k];
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"game\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    phase_names[e->phase], to_us(e->start), to_us(e->end) - to_us(e->start));
+        }
+    }
+    fprintf(f, "\n]}\n");
+    int ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+static int cmp_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// p50/p95/p99 of a phase over the buffered frames
+static void phase_percentiles(int phase, float out[3]) {
+    static float tmp[PROFILER_HISTORY];
+    out[0] = out[1] = out[2] = 0.0f;
+    if (frame_total == 0) return;
+    for (int i = 0; i < frame_total; ++i) tmp[i] = frame_at(i)->phase_ms[phase];
+    qsort(tmp, (size_t)frame_total, sizeof(float), cmp_float);
+    out[0] = tmp[(frame_total - 1) * 50 / 100];
+    out[1] = tmp[(frame_total - 1) * 95 / 100];
+    out[2] = tmp[(frame_total - 1) * 99 / 100];
+}
+
+void prof_draw_overlay(int x, int y) {
+    const int graph_h = 80, line_h = 18;
+    const float budget_ms = 1000.0f / 60.0f;
+    const float graph_scale = graph_h / (2.0f * budget_ms); // two frame budgets fill the graph
+    SDL_Color white = { 230, 230, 230, 255 };
+    int w = PROFILER_HISTORY + 8 > 300 ? PROFILER_HISTORY + 8 : 300;
+    int h = graph_h + 12 + line_h * (PROF_PHASE_COUNT + 1) + 8;
+    batch_rect((float)x, (float)y, (float)w, (float)h, (SDL_Color){ 0, 0, 0, 190 });
+
+    // frame-time graph, newest on the right; green within budget, yellow within two, red beyond
+    int gx = x + 4, gy = y + 4 + graph_h;
+    for (int i = 0; i < frame_total; ++i) {
+        float ms = frame_at(i)->phase_ms[PROF_FRAME];
+        float bh = ms * graph_scale; if (bh > graph_h) bh = (float)graph_h;
+        SDL_Color c = ms <= budget_ms ? (SDL_Color){ 80, 200, 80, 255 }
+                    : ms <= 2.0f * budget_ms ? (SDL_Color){ 230, 200, 60, 255 } : (SDL_Color){ 230, 60, 60, 255 };
+        batch_rect((float)(gx + PROFILER_HISTORY - frame_total + i), gy - bh, 1.0f, bh, c);
+    }
+    batch_rect((float)gx, gy - budget_ms * graph_scale, (float)PROFILER_HISTORY, 1.0f, (SDL_Color){ 255, 255, 255, 120 });
+
+    // per-phase percentiles in ms
+    int ty = y + graph_h + 12;
+    char buf[96];
+    text_draw(x + 4, ty, "phase ms     p50    p95    p99", white);
+    ty += line_h;
+    for (int p = 0; p < PROF_PHASE_COUNT; ++p) {
+        float pc[3];
+        phase_percentiles(p, pc);
+        snprintf(buf, sizeof(buf), "%-10s %6.2f %6.2f %6.2f", phase_names[p], pc[0], pc[1], pc[2]);
+        text_draw(x + 4, ty + p * line_h, buf, white);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// frame profiler: prof_begin/prof_end pairs time a phase with SDL_GetPerformanceCounter.
+// Every frame's scopes go into a ring buffer of the last PROFILER_HISTORY frames, which the
+// F3 overlay summarizes and prof_write_trace exports as Chrome trace-event JSON
+// (chrome://tracing, Perfetto). Main thread only.
+enum {
+    PROF_FRAME,
+    PROF_INPUT,
+    PROF_LEVEL_LOAD, // poll_level_loader: atlas uploads and the level swap
+    PROF_UPDATE,
+    PROF_NPC_AI,
+    PROF_PICKUP,
+    PROF_TILES,
+    PROF_ENTITIES,
+    PROF_LIGHTING, // light map composition, upload and draw
+    PROF_UI_PANEL,
+    PROF_PRESENT,
+    PROF_PHASE_COUNT
+};
+
+void prof_init(void);
+void prof_set_enabled(int enabled);
+int prof_enabled(void);
+// scopes nest (at most PROFILER_MAX_DEPTH deep) and must be closed in reverse order
+void prof_begin(int phase);
+void prof_end(int phase);
+// frame boundaries; prof_frame_end also closes the PROF_FRAME scope
+void prof_frame_begin(void);
+void prof_frame_end(void);
+// write the buffered frames as Chrome trace-event JSON
+int prof_write_trace(const char* path);
+// frame-time graph and per-phase percentiles, drawn through the batcher at (x, y)
+void prof_draw_overlay(int x, int y);
+
+#endif
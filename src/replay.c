@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "./constants.h"
+#include "./replay.h"
+
+static FILE* rec_file = NULL;
+static uint32_t rec_ticks = 0;
+static FILE* play_file = NULL;
+static uint32_t play_ticks = 0, play_pos = 0;
+
+int replay_record_begin(const char* path, const ReplayHeader* header) {
+    replay_record_end();
+    rec_file = fopen(path, "wb");
+    if (!rec_file) return FALSE;
+    ReplayHeader h = *header;
+    memcpy(h.magic, REPLAY_MAGIC, 4);
+    h.version = REPLAY_VERSION;
+    h.tick_count = 0;
+    h.level[sizeof(h.level) - 1] = '\0';
+    if (fwrite(&h, sizeof(h), 1, rec_file) != 1) { fclose(rec_file); rec_file = NULL; return FALSE; }
+    rec_ticks = 0;
+    return TRUE;
+}
+
+// after the header, 5 bytes per tick: input, then the state hash (native byte order, like .lvlb)
+void replay_record_tick(uint8_t input, uint32_t hash) {
+    if (!rec_file) return;
+    uint8_t rec[5];
+    rec[0] = input;
+    memcpy(rec + 1, &hash, sizeof(hash));
+    fwrite(rec, sizeof(rec), 1, rec_file);
+    rec_ticks++;
+}
+
+int replay_record_end(void) {
+    if (!rec_file) return FALSE;
+    int ok = !ferror(rec_file);
+    if (fseek(rec_file, (long)offsetof(ReplayHeader, tick_count), SEEK_SET) == 0) ok &= fwrite(&rec_ticks, sizeof(rec_ticks), 1, rec_file) == 1;
+    else ok = FALSE;
+    ok &= fclose(rec_file) == 0;
+    rec_file = NULL;
+    return ok;
+}
+
+int replay_open(const char* path, ReplayHeader* header) {
+    replay_close();
+    play_file = fopen(path, "rb");
+    if (!play_file) return FALSE;
+    if (fread(header, sizeof(*header), 1, play_file) != 1 || memcmp(header->magic, REPLAY_MAGIC, 4) != 0 || header->version != REPLAY_VERSION) {
+        replay_close();
+        return FALSE;
+    }
+    header->level[sizeof(header->level) - 1] = '\0';
+    play_ticks = header->tick_count;
+    play_pos = 0;
+    return TRUE;
+}
+
+int replay_next(uint8_t* input, uint32_t* hash) {
+    uint8_t rec[5];
+    if (!play_file || play_pos >= play_ticks || fread(rec, sizeof(rec), 1, play_file) != 1) return FALSE;
+    *input = rec[0];
+    memcpy(hash, rec + 1, sizeof(*hash));
+    play_pos++;
+    return TRUE;
+}
+
+int replay_tick(void) { return (int)play_pos; }
+
+void replay_close(void) {
+    if (play_file) fclose(play_file);
+    play_file = NULL;
+    play_ticks = play_pos = 0;
+}
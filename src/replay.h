@@ -0,0 +1,40 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+
+// Input recordings: everything the simulation needs to re-run a session bit for bit (seed,
+// tick rate, level, world settings), then one record per tick: the input byte the tick ran
+// with and a hash of the game state after it. Replaying feeds the inputs back and compares
+// the hashes, so the first divergent tick is known exactly.
+#define REPLAY_MAGIC "RPLY"
+#define REPLAY_VERSION 3 // 2: attack/talk/confirm bits are presses; 3: restart goes back to the level start
+// input bits 0-6 belong to the game; bit 7 marks a tick that starts right after a level swap
+#define REPLAY_LEVEL_SWAP 0x80
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t seed;
+    uint32_t tick_rate;
+    uint32_t residency_radius;
+    uint32_t max_npcs;
+    uint32_t tick_count; // filled in when the recording is closed
+    char level[256];
+} ReplayHeader;
+
+// start writing a recording; the header's tick_count is ignored
+int replay_record_begin(const char* path, const ReplayHeader* header);
+void replay_record_tick(uint8_t input, uint32_t hash);
+// patch the tick count into the header and close the file
+int replay_record_end(void);
+
+// open a recording for playback; fills the header
+int replay_open(const char* path, ReplayHeader* header);
+// next tick's input and expected state hash; FALSE when the recording ends
+int replay_next(uint8_t* input, uint32_t* hash);
+// ticks read so far
+int replay_tick(void);
+void replay_close(void);
+
+#endif
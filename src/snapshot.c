@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./constants.h"
+#include "./snapshot.h"
+
+void snapshot_free(Snapshot* s) {
+    free(s->data);
+    memset(s, 0, sizeof(*s));
+}
+
+static int reserve(Snapshot* s, size_t need) {
+    if (need <= s->capacity) return TRUE;
+    size_t cap = s->capacity ? s->capacity : 4096;
+    while (cap < need) cap *= 2;
+    uint8_t* p = realloc(s->data, cap);
+    if (!p) return FALSE;
+    s->data = p; s->capacity = cap;
+    return TRUE;
+}
+
+void snapshot_begin(Snapshot* s, const char* level) {
+    s->size = s->pos = 0;
+    s->failed = 0;
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, 4);
+    h.version = SNAPSHOT_VERSION;
+    snprintf(h.level, sizeof(h.level), "%s", level ? level : "");
+    snapshot_put(s, &h, sizeof(h));
+}
+
+void snapshot_put(Snapshot* s, const void* p, size_t n) {
+    if (s->failed || !reserve(s, s->size + n)) { s->failed = 1; return; }
+    memcpy(s->data + s->size, p, n);
+    s->size += n;
+}
+
+int snapshot_end(Snapshot* s) {
+    if (s->failed || s->size < sizeof(SnapshotHeader)) return FALSE;
+    uint32_t size = (uint32_t)(s->size - sizeof(SnapshotHeader));
+    memcpy(s->data + offsetof(SnapshotHeader, size), &size, sizeof(size));
+    return TRUE;
+}
+
+int snapshot_open(Snapshot* s) {
+    s->pos = 0;
+    s->failed = 1;
+    if (s->size < sizeof(SnapshotHeader)) return FALSE;
+    const SnapshotHeader* h = snapshot_header(s);
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, 4) != 0 || h->version != SNAPSHOT_VERSION) return FALSE;
+    if (h->size != s->size - sizeof(SnapshotHeader) || h->level[sizeof(h->level) - 1] != '\0') return FALSE;
+    s->pos = sizeof(SnapshotHeader);
+    s->failed = 0;
+    return TRUE;
+}
+
+const SnapshotHeader* snapshot_header(const Snapshot* s) { return (const SnapshotHeader*)s->data; }
+
+int snapshot_get(Snapshot* s, void* p, size_t n) {
+    if (s->failed || n > s->size - s->pos) { s->failed = 1; return FALSE; }
+    memcpy(p, s->data + s->pos, n);
+    s->pos += n;
+    return TRUE;
+}
+
+size_t snapshot_remaining(const Snapshot* s) { return s->failed ? 0 : s->size - s->pos; }
+
+int snapshot_write_file(const Snapshot* s, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return FALSE;
+    int ok = fwrite(s->data, 1, s->size, f) == s->size;
+    ok &= fclose(f) == 0;
+    return ok;
+}
+
+int snapshot_read_file(Snapshot* s, const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return FALSE;
+    long len = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    int ok = len > 0 && fseek(f, 0, SEEK_SET) == 0 && reserve(s, (size_t)len) && fread(s->data, 1, (size_t)len, f) == (size_t)len;
+    fclose(f);
+    s->size = ok ? (size_t)len : 0;
+    s->pos = 0;
+    s->failed = !ok;
+    return ok;
+}
+
+int snapshot_ring_init(SnapshotRing* r, int capacity) {
+    memset(r, 0, sizeof(*r));
+    r->items = calloc((size_t)capacity, sizeof(Snapshot));
+    if (!r->items) return FALSE;
+    r->capacity = capacity;
+    return TRUE;
+}
+
+void snapshot_ring_free(SnapshotRing* r) {
+    for (int i = 0; i < r->capacity; ++i) snapshot_free(&r->items[i]);
+    free(r->items);
+    memset(r, 0, sizeof(*r));
+}
+
+void snapshot_ring_clear(SnapshotRing* r) { r->head = r->count = 0; }
+
+Snapshot* snapshot_ring_push(SnapshotRing* r) {
+    if (r->capacity == 0) return NULL;
+    Snapshot* s = &r->items[r->head];
+    r->head = (r->head + 1) % r->capacity;
+    if (r->count < r->capacity) r->count++;
+    return s;
+}
+
+Snapshot* snapshot_ring_pop(SnapshotRing* r) {
+    if (r->count == 0) return NULL;
+    r->head = (r->head + r->capacity - 1) % r->capacity;
+    r->count--;
+    return &r->items[r->head];
+}
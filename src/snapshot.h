@@ -0,0 +1,57 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Game-state snapshots: a header, then the sections the game writes its simulation state in
+// (native byte order, like .lvlb). Nothing in a snapshot is a pointer; sprites are looked up
+// again by token id when one is restored. Buffers keep their memory when reused, so taking a
+// snapshot every tick does not allocate once the ring has filled.
+#define SNAPSHOT_MAGIC "SNAP"
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t size;   // bytes of state after the header
+    char level[256]; // level file the state was taken on
+} SnapshotHeader;
+
+typedef struct {
+    uint8_t* data;   // header, then the state
+    size_t size, capacity;
+    size_t pos;      // read position
+    int failed;      // a write could not grow the buffer, or a read ran past the end
+} Snapshot;
+
+void snapshot_free(Snapshot* s);
+// start writing a state taken on `level`; keeps the buffer's memory
+void snapshot_begin(Snapshot* s, const char* level);
+void snapshot_put(Snapshot* s, const void* p, size_t n);
+// fill in the header's size; FALSE if any write failed
+int snapshot_end(Snapshot* s);
+// start reading a finished snapshot: checks magic, version and size
+int snapshot_open(Snapshot* s);
+const SnapshotHeader* snapshot_header(const Snapshot* s);
+int snapshot_get(Snapshot* s, void* p, size_t n);
+// bytes left to read
+size_t snapshot_remaining(const Snapshot* s);
+int snapshot_write_file(const Snapshot* s, const char* path);
+int snapshot_read_file(Snapshot* s, const char* path);
+
+// the last `capacity` snapshots, newest on top; pushing onto a full ring reuses the oldest
+typedef struct {
+    Snapshot* items;
+    int capacity, head, count; // head: next slot to push into
+} SnapshotRing;
+
+int snapshot_ring_init(SnapshotRing* r, int capacity);
+void snapshot_ring_free(SnapshotRing* r);
+void snapshot_ring_clear(SnapshotRing* r);
+// buffer for a new newest snapshot
+Snapshot* snapshot_ring_push(SnapshotRing* r);
+// take the newest snapshot off the ring (valid until the next push); NULL when empty
+Snapshot* snapshot_ring_pop(SnapshotRing* r);
+
+#endif
@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./constants.h"
+#include "./spatial.h"
+
+int spatial_init(SpatialGrid* g, int capacity, float cell_size) {
+    memset(g, 0, sizeof(*g));
+    g->cell_size = cell_size;
+    g->capacity = capacity;
+    g->next = malloc(sizeof(int) * capacity);
+    g->prev = malloc(sizeof(int) * capacity);
+    g->cell_of = malloc(sizeof(int) * capacity);
+    g->px = malloc(sizeof(float) * capacity);
+    g->py = malloc(sizeof(float) * capacity);
+    if (!g->next || !g->prev || !g->cell_of || !g->px || !g->py) { spatial_free(g); return FALSE; }
+    for (int i = 0; i < capacity; ++i) g->cell_of[i] = -1;
+    return TRUE;
+}
+
+int spatial_reserve(SpatialGrid* g, int capacity) {
+    if (capacity <= g->capacity) return TRUE;
+    int* next = realloc(g->next, sizeof(int) * capacity); if (!next) return FALSE; g->next = next;
+    int* prev = realloc(g->prev, sizeof(int) * capacity); if (!prev) return FALSE; g->prev = prev;
+    int* cell_of = realloc(g->cell_of, sizeof(int) * capacity); if (!cell_of) return FALSE; g->cell_of = cell_of;
+    float* px = realloc(g->px, sizeof(float) * capacity); if (!px) return FALSE; g->px = px;
+    float* py = realloc(g->py, sizeof(float) * capacity); if (!py) return FALSE; g->py = py;
+    for (int i = g->capacity; i < capacity; ++i) g->cell_of[i] = -1;
+    g->capacity = capacity;
+    return TRUE;
+}
+
+void spatial_free(SpatialGrid* g) {
+    free(g->cell_head); free(g->next); free(g->prev); free(g->cell_of); free(g->px); free(g->py);
+    memset(g, 0, sizeof(*g));
+}
+
+int spatial_reset(SpatialGrid* g, float origin_x, float origin_y, int rows, int cols) {
+    if (rows < 1) rows = 1;
+    if (cols < 1) cols = 1;
+    if (rows * cols != g->rows * g->cols || !g->cell_head) {
+        int* heads = realloc(g->cell_head, sizeof(int) * rows * cols);
+        if (!heads) return FALSE;
+        g->cell_head = heads;
+    }
+    g->rows = rows; g->cols = cols;
+    g->origin_x = origin_x; g->origin_y = origin_y;
+    for (int i = 0; i < rows * cols; ++i) g->cell_head[i] = -1;
+    for (int i = 0; i < g->capacity; ++i) g->cell_of[i] = -1;
+    return TRUE;
+}
+
+// cell containing a point; points off the grid are clamped to the border cells
+static int cell_index(const SpatialGrid* g, float x, float y) {
+    x -= g->origin_x; y -= g->origin_y;
+    int c = (int)(x / g->cell_size), r = (int)(y / g->cell_size);
+    if (x < 0) c = 0;
+    if (y < 0) r = 0;
+    if (c >= g->cols) c = g->cols - 1;
+    if (r >= g->rows) r = g->rows - 1;
+    return r * g->cols + c;
+}
+
+static void link_id(SpatialGrid* g, int id, int cell) {
+    int head = g->cell_head[cell];
+    g->prev[id] = -1;
+    g->next[id] = head;
+    if (head >= 0) g->prev[head] = id;
+    g->cell_head[cell] = id;
+    g->cell_of[id] = cell;
+}
+
+static void unlink_id(SpatialGrid* g, int id) {
+    int cell = g->cell_of[id];
+    if (cell < 0) return;
+    if (g->prev[id] >= 0) g->next[g->prev[id]] = g->next[id];
+    else g->cell_head[cell] = g->next[id];
+    if (g->next[id] >= 0) g->prev[g->next[id]] = g->prev[id];
+    g->cell_of[id] = -1;
+}
+
+void spatial_insert(SpatialGrid* g, int id, float x, float y) {
+    if (id < 0 || id >= g->capacity || !g->cell_head) return;
+    unlink_id(g, id);
+    g->px[id] = x; g->py[id] = y;
+    link_id(g, id, cell_index(g, x, y));
+}
+
+void spatial_remove(SpatialGrid* g, int id) {
+    if (id < 0 || id >= g->capacity) return;
+    unlink_id(g, id);
+}
+
+void spatial_move(SpatialGrid* g, int id, float x, float y) {
+    if (id < 0 || id >= g->capacity || g->cell_of[id] < 0) return;
+    g->px[id] = x; g->py[id] = y;
+    int cell = cell_index(g, x, y);
+    if (cell == g->cell_of[id]) return;
+    unlink_id(g, id);
+    link_id(g, id, cell);
+}
+
+void spatial_rename(SpatialGrid* g, int from, int to) {
+    if (from == to || from < 0 || to < 0 || from >= g->capacity || to >= g->capacity) return;
+    unlink_id(g, to);
+    int cell = g->cell_of[from];
+    if (cell < 0) return;
+    float x = g->px[from], y = g->py[from];
+    unlink_id(g, from);
+    g->px[to] = x; g->py[to] = y;
+    link_id(g, to, cell);
+}
+
+// cells overlapping [x0, x1] x [y0, y1], clamped to the grid
+static void cell_rect(const SpatialGrid* g, float x0, float y0, float x1, float y1, int* r0, int* r1, int* c0, int* c1) {
+    x0 -= g->origin_x; x1 -= g->origin_x; y0 -= g->origin_y; y1 -= g->origin_y;
+    *c0 = (int)(x0 / g->cell_size); *c1 = (int)(x1 / g->cell_size);
+    *r0 = (int)(y0 / g->cell_size); *r1 = (int)(y1 / g->cell_size);
+    if (x0 < 0) *c0 = 0;
+    if (y0 < 0) *r0 = 0;
+    if (*c1 >= g->cols) *c1 = g->cols - 1;
+    if (*r1 >= g->rows) *r1 = g->rows - 1;
+    // entities off the grid live in the border cells, so always include those when touched
+    if (*c0 >= g->cols) *c0 = g->cols - 1;
+    if (*r0 >= g->rows) *r0 = g->rows - 1;
+    if (*c1 < 0) *c1 = 0;
+    if (*r1 < 0) *r1 = 0;
+}
+
+// cell range overlapping the square around (x,y)
+static void cell_range(const SpatialGrid* g, float x, float y, float radius, int* r0, int* r1, int* c0, int* c1) {
+    cell_rect(g, x - radius, y - radius, x + radius, y + radius, r0, r1, c0, c1);
+}
+
+int spatial_nearest(const SpatialGrid* g, float x, float y, float radius) {
+    if (!g->cell_head) return -1;
+    int r0, r1, c0, c1;
+    cell_range(g, x, y, radius, &r0, &r1, &c0, &c1);
+    float best = radius * radius; int best_id = -1;
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            for (int id = g->cell_head[r * g->cols + c]; id >= 0; id = g->next[id]) {
+                float dx = g->px[id] - x, dy = g->py[id] - y;
+                float d2 = dx*dx + dy*dy;
+                // ties go to the lower id, matching a front-to-back array scan
+                if (d2 < best || (d2 == best && best_id >= 0 && id < best_id)) { best = d2; best_id = id; }
+            }
+        }
+    }
+    return best_id;
+}
+
+int spatial_query_radius(const SpatialGrid* g, float x, float y, float radius, int* out, int max_out) {
+    if (!g->cell_head) return 0;
+    int r0, r1, c0, c1;
+    cell_range(g, x, y, radius, &r0, &r1, &c0, &c1);
+    float r2 = radius * radius; int n = 0;
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            for (int id = g->cell_head[r * g->cols + c]; id >= 0; id = g->next[id]) {
+                float dx = g->px[id] - x, dy = g->py[id] - y;
+                if (dx*dx + dy*dy <= r2 && n < max_out) out[n++] = id;
+            }
+        }
+    }
+    return n;
+}
+
+int spatial_query_rect(const SpatialGrid* g, float x0, float y0, float x1, float y1, int* out, int max_out) {
+    if (!g->cell_head) return 0;
+    int r0, r1, c0, c1;
+    cell_rect(g, x0, y0, x1, y1, &r0, &r1, &c0, &c1);
+    int n = 0;
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            for (int id = g->cell_head[r * g->cols + c]; id >= 0; id = g->next[id]) {
+                if (g->px[id] >= x0 && g->px[id] < x1 && g->py[id] >= y0 && g->py[id] < y1 && n < max_out) out[n++] = id;
+            }
+        }
+    }
+    return n;
+}
@@ -0,0 +1,39 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+// uniform grid over the tile map for proximity queries. Entities are small integer ids
+// (array slots) linked into per-cell lists, so moving, inserting and removing are O(1)
+// and queries only visit the cells overlapping the search radius.
+typedef struct {
+    int rows, cols;    // grid size in cells
+    float cell_size;   // cell edge in pixels (TILE_SIZE: cells line up with tiles)
+    float origin_x, origin_y; // pixel position of the top-left cell
+    int capacity;      // ids are 0..capacity-1
+    int* cell_head;    // first id in each cell, -1 = empty
+    int* next;         // per id: next/prev id in the same cell
+    int* prev;
+    int* cell_of;      // per id: cell index, -1 = not in the grid
+    float* px;         // per id: position last inserted/moved to
+    float* py;
+} SpatialGrid;
+
+int spatial_init(SpatialGrid* g, int capacity, float cell_size);
+void spatial_free(SpatialGrid* g);
+// grow to at least capacity ids, keeping every linked id in place
+int spatial_reserve(SpatialGrid* g, int capacity);
+// cover rows x cols cells starting at (origin_x, origin_y) and remove every id
+int spatial_reset(SpatialGrid* g, float origin_x, float origin_y, int rows, int cols);
+void spatial_insert(SpatialGrid* g, int id, float x, float y);
+void spatial_remove(SpatialGrid* g, int id);
+// update an id's position; relinks only when it crosses into another cell
+void spatial_move(SpatialGrid* g, int id, float x, float y);
+// an entity changed array slot (e.g. removal compaction): relabel from -> to
+void spatial_rename(SpatialGrid* g, int from, int to);
+// nearest id strictly within radius of (x,y), -1 if none
+int spatial_nearest(const SpatialGrid* g, float x, float y, float radius);
+// all ids within radius of (x,y), the boundary included; returns how many were written to out
+int spatial_query_radius(const SpatialGrid* g, float x, float y, float radius, int* out, int max_out);
+// all ids positioned in [x0, x1) x [y0, y1); returns how many were written to out
+int spatial_query_rect(const SpatialGrid* g, float x0, float y0, float x1, float y1, int* out, int max_out);
+
+#endif
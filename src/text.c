@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "./constants.h"
+#include "./atlas.h"
+#include "./batch.h"
+#include "./text.h"
+
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+
+enum { FONT_TTF = 0, FONT_SMALL = 1 };
+
+// small 3x5 bitmap font for 0-9 and a few letters (H,P,C,W)
+// each entry is 5 rows of 3 bits (LSB is rightmost pixel)
+static const uint8_t font_3x5_digits[16][5] = {
+    // 0
+    {0b111,0b101,0b101,0b101,0b111},
+    // 1
+    {0b010,0b110,0b010,0b010,0b111},
+    // 2
+    {0b111,0b001,0b111,0b100,0b111},
+    // 3
+    {0b111,0b001,0b111,0b001,0b111},
+    // 4
+    {0b101,0b101,0b111,0b001,0b001},
+    // 5
+    {0b111,0b100,0b111,0b001,0b111},
+    // 6
+    {0b111,0b100,0b111,0b101,0b111},
+    // 7
+    {0b111,0b001,0b010,0b100,0b100},
+    // 8
+    {0b111,0b101,0b111,0b101,0b111},
+    // 9
+    {0b111,0b101,0b111,0b001,0b111},
+    // 10: H
+    {0b101,0b101,0b111,0b101,0b101},
+    // 11: P
+    {0b111,0b101,0b111,0b100,0b100},
+    // 12: C
+    {0b111,0b100,0b100,0b100,0b111},
+    // 13: W
+    {0b101,0b101,0b101,0b111,0b101},
+    // 14: ':'
+    {0b000,0b010,0b000,0b010,0b000},
+    // 15: '/'
+    {0b001,0b001,0b010,0b100,0b100}
+};
+
+static int char_to_font_index(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch == 'H') return 10;
+    if (ch == 'P') return 11;
+    if (ch == 'C') return 12;
+    if (ch == 'W') return 13;
+    if (ch == ':') return 14;
+    if (ch == '/') return 15;
+    return -1;
+}
+
+// glyph sprites in the atlas
+static Sprite ttf_glyphs[GLYPH_COUNT];
+static int ttf_advance[GLYPH_COUNT];
+static int ttf_height = 0;
+static int have_ttf = 0;
+static Sprite small_glyphs[16];
+
+// a laid-out string: which glyph goes where, relative to the draw origin
+typedef struct {
+    int used;
+    int font;
+    Uint32 hash;
+    char text[TEXT_MAX_LEN];
+    int len;
+    int width, height; // TTF: pixels, bitmap: font units (multiply by scale)
+    uint8_t glyph[TEXT_MAX_LEN]; // index into ttf_glyphs / small_glyphs
+    int16_t x[TEXT_MAX_LEN];
+} TextLayout;
+
+static TextLayout layout_cache[TEXT_CACHE_SLOTS];
+
+// strings are keyed (and laid out) by their first TEXT_MAX_LEN - 1 bytes only, so an over-long
+// string still hits the entry it was stored under
+static Uint32 hash_text(const char* s, int font) {
+    Uint32 h = 2166136261u ^ (Uint32)font;
+    for (int n = 0; s[n] && n < TEXT_MAX_LEN - 1; ++n) h = (h ^ (unsigned char)s[n]) * 16777619u;
+    return h;
+}
+
+static void layout_text(TextLayout* l, const char* s, int font) {
+    int x = 0, n = 0;
+    for (const char* p = s; *p && n < TEXT_MAX_LEN - 1; ++p) {
+        unsigned char ch = (unsigned char)*p;
+        if (font == FONT_TTF) {
+            if (ch < GLYPH_FIRST || ch > GLYPH_LAST) ch = '?';
+            int gi = ch - GLYPH_FIRST;
+            if (ch != ' ') { l->glyph[n] = (uint8_t)gi; l->x[n] = (int16_t)x; n++; }
+            x += ttf_advance[gi];
+        } else {
+            int gi = char_to_font_index((char)ch);
+            if (gi >= 0) { l->glyph[n] = (uint8_t)gi; l->x[n] = (int16_t)x; n++; }
+            x += 3 + 1;
+        }
+    }
+    l->len = n;
+    l->width = x;
+    l->height = font == FONT_TTF ? ttf_height : 5;
+}
+
+// find the cached layout for a string, laying it out on a miss
+static const TextLayout* get_layout(const char* s, int font) {
+    Uint32 h = hash_text(s, font);
+    int home = (int)(h % TEXT_CACHE_SLOTS);
+    int free_slot = -1;
+    for (int probe = 0; probe < 4; ++probe) {
+        TextLayout* l = &layout_cache[(home + probe) % TEXT_CACHE_SLOTS];
+        if (!l->used) { if (free_slot < 0) free_slot = (home + probe) % TEXT_CACHE_SLOTS; continue; }
+        if (l->hash == h && l->font == font && strncmp(l->text, s, TEXT_MAX_LEN - 1) == 0) return l;
+    }
+    // miss: take a free probe slot, otherwise evict the home slot
+    TextLayout* l = &layout_cache[free_slot >= 0 ? free_slot : home];
+    l->used = 1; l->font = font; l->hash = h;
+    strncpy(l->text, s, TEXT_MAX_LEN - 1); l->text[TEXT_MAX_LEN - 1] = '\0';
+    layout_text(l, l->text, font);
+    return l;
+}
+
+static void build_small_glyphs(void) {
+    SDL_Surface* s = SDL_CreateRGBSurfaceWithFormat(0, 3, 5, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!s) return;
+    for (int i = 0; i < 16; ++i) {
+        SDL_LockSurface(s);
+        for (int row = 0; row < 5; ++row) {
+            Uint32* px = (Uint32*)((Uint8*)s->pixels + row * s->pitch);
+            for (int col = 0; col < 3; ++col) {
+                int lit = (font_3x5_digits[i][row] & (1 << (2-col))) != 0;
+                px[col] = SDL_MapRGBA(s->format, 255, 255, 255, lit ? 255 : 0);
+            }
+        }
+        SDL_UnlockSurface(s);
+        atlas_add_surface(s, 3, 5, &small_glyphs[i]);
+    }
+    SDL_FreeSurface(s);
+}
+
+static void build_ttf_glyphs(TTF_Font* font) {
+    const SDL_Color white = { 255, 255, 255, 255 };
+    ttf_height = TTF_FontHeight(font);
+    for (int i = 0; i < GLYPH_COUNT; ++i) {
+        Uint16 ch = (Uint16)(GLYPH_FIRST + i);
+        int minx, maxx, miny, maxy, adv = 0;
+        if (TTF_GlyphMetrics(font, ch, &minx, &maxx, &miny, &maxy, &adv) != 0) adv = ttf_height / 2;
+        ttf_advance[i] = adv;
+        if (ch == ' ') continue;
+        SDL_Surface* g = TTF_RenderGlyph_Blended(font, ch, white);
+        if (!g) continue;
+        atlas_add_surface(g, g->w, g->h, &ttf_glyphs[i]);
+        SDL_FreeSurface(g);
+    }
+    have_ttf = 1;
+}
+
+int text_init(TTF_Font* font) {
+    memset(layout_cache, 0, sizeof(layout_cache));
+    build_small_glyphs();
+    have_ttf = 0;
+    if (font) build_ttf_glyphs(font);
+    return TRUE;
+}
+
+void text_shutdown(void) {
+    // glyph sprites live in the atlas pages, which the atlas owns
+    memset(ttf_glyphs, 0, sizeof(ttf_glyphs));
+    memset(small_glyphs, 0, sizeof(small_glyphs));
+    memset(layout_cache, 0, sizeof(layout_cache));
+    have_ttf = 0;
+}
+
+void text_draw_small(int x, int y, int scale, SDL_Color color, const char* s) {
+    const TextLayout* l = get_layout(s, FONT_SMALL);
+    for (int i = 0; i < l->len; ++i) {
+        batch_sprite(&small_glyphs[l->glyph[i]], x + l->x[i] * scale, y, 3 * scale, 5 * scale, color);
+    }
+}
+
+void text_draw(int x, int y, const char* s, SDL_Color color) {
+    if (!have_ttf) { text_draw_small(x, y, 3, color, s); return; }
+    const TextLayout* l = get_layout(s, FONT_TTF);
+    for (int i = 0; i < l->len; ++i) {
+        const Sprite* g = &ttf_glyphs[l->glyph[i]];
+        batch_sprite(g, x + l->x[i], y, g->src.w, g->src.h, color);
+    }
+}
+
+void text_size(const char* s, int* w, int* h) {
+    if (!have_ttf) {
+        const TextLayout* l = get_layout(s, FONT_SMALL);
+        *w = l->width * 3; *h = l->height * 3;
+        return;
+    }
+    const TextLayout* l = get_layout(s, FONT_TTF);
+    *w = l->width; *h = l->height;
+}
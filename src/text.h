@@ -0,0 +1,18 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+// glyph-atlas text: glyphs of the UI font and the 3x5 bitmap font are packed into the
+// sprite atlas once, strings are laid out into cached glyph runs and drawn as batched quads
+int text_init(TTF_Font* font); // font may be NULL (bitmap font only)
+void text_shutdown(void);
+// draw with the TTF font (bitmap font at scale 3 when no font is loaded)
+void text_draw(int x, int y, const char* s, SDL_Color color);
+// draw with the 3x5 bitmap font
+void text_draw_small(int x, int y, int scale, SDL_Color color, const char* s);
+// pixel size of a string drawn by text_draw
+void text_size(const char* s, int* w, int* h);
+
+#endif
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./constants.h"
+#include "./watch.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/inotify.h>
+
+static int watch_fd = -1;
+static struct { int wd; char path[256]; } dirs[WATCH_MAX_DIRS];
+static int dir_count = 0;
+// events read but not handed out yet
+static char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+static ssize_t events_len = 0, events_pos = 0;
+
+int watch_init(void) {
+    watch_shutdown();
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    return watch_fd >= 0;
+}
+
+void watch_shutdown(void) {
+    if (watch_fd >= 0) close(watch_fd); // drops every watch with it
+    watch_fd = -1;
+    dir_count = 0;
+    events_len = events_pos = 0;
+}
+
+int watch_dir(const char* dir) {
+    if (watch_fd < 0 || dir_count >= WATCH_MAX_DIRS) return FALSE;
+    // a finished write, or a file renamed into place
+    int wd = inotify_add_watch(watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) return FALSE;
+    dirs[dir_count].wd = wd;
+    snprintf(dirs[dir_count].path, sizeof(dirs[dir_count].path), "%s", dir);
+    dir_count++;
+    return TRUE;
+}
+
+int watch_next(char* path, size_t size) {
+    if (watch_fd < 0) return FALSE;
+    for (;;) {
+        if (events_pos >= events_len) {
+            events_len = read(watch_fd, events, sizeof(events));
+            events_pos = 0;
+            if (events_len <= 0) { events_len = 0; return FALSE; }
+        }
+        const struct inotify_event* e = (const struct inotify_event*)(events + events_pos);
+        events_pos += (ssize_t)(sizeof(*e) + e->len);
+        if (e->len == 0 || (e->mask & IN_ISDIR)) continue;
+        for (int i = 0; i < dir_count; ++i) {
+            if (dirs[i].wd != e->wd) continue;
+            snprintf(path, size, "%s/%s", dirs[i].path, e->name);
+            return TRUE;
+        }
+    }
+}
+
+#else
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+
+// sub-second modification times where stat has them, so two saves within a second both show;
+// the size is compared too for the stat (MinGW's) that only has whole seconds
+#if defined(__APPLE__)
+#define MTIME_NSEC(st) ((long)(st).st_mtimespec.tv_nsec)
+#elif defined(_WIN32)
+#define MTIME_NSEC(st) 0L
+#else
+#define MTIME_NSEC(st) ((long)(st).st_mtim.tv_nsec)
+#endif
+
+typedef struct { char name[64]; time_t mtime; long mtime_nsec; off_t size; } WatchEntry;
+
+static int watching = FALSE;
+static struct { char path[256]; WatchEntry* entries; int count, cap; } dirs[WATCH_MAX_DIRS];
+static int dir_count = 0;
+static Uint32 next_scan = 0;
+// changed files found by the last scan, handed out one by one
+static char pending[WATCH_MAX_DIRS * 4][320];
+static int pending_count = 0, pending_pos = 0;
+
+// record every file's modification time; report the ones that are new or changed. Stops
+// early when the pending list is full: the files not looked at yet stay as they were
+// recorded, so the next scan reports them.
+static void scan_dir(int d, int report) {
+    DIR* dp = opendir(dirs[d].path);
+    if (!dp) return;
+    struct dirent* e;
+    while ((e = readdir(dp)) != NULL) {
+        size_t len = strlen(e->d_name);
+        if (e->d_name[0] == '.' || len >= sizeof(dirs[d].entries[0].name)) continue;
+        char path[320];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%.63s", dirs[d].path, e->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        if (report && pending_count == (int)(sizeof(pending) / sizeof(pending[0]))) break;
+        int k = 0;
+        while (k < dirs[d].count && strcmp(dirs[d].entries[k].name, e->d_name) != 0) ++k;
+        if (k == dirs[d].count) {
+            if (dirs[d].count == dirs[d].cap) {
+                int cap = dirs[d].cap ? dirs[d].cap * 2 : 32;
+                WatchEntry* p = realloc(dirs[d].entries, sizeof(WatchEntry) * (size_t)cap);
+                if (!p) break;
+                dirs[d].entries = p; dirs[d].cap = cap;
+            }
+            memcpy(dirs[d].entries[k].name, e->d_name, len + 1);
+            dirs[d].count++;
+        } else {
+            const WatchEntry* w = &dirs[d].entries[k];
+            if (w->mtime == st.st_mtime && w->mtime_nsec == MTIME_NSEC(st) && w->size == st.st_size) continue;
+        }
+        dirs[d].entries[k].mtime = st.st_mtime;
+        dirs[d].entries[k].mtime_nsec = MTIME_NSEC(st);
+        dirs[d].entries[k].size = st.st_size;
+        if (report) memcpy(pending[pending_count++], path, sizeof(path));
+    }
+    closedir(dp);
+}
+
+int watch_init(void) {
+    watch_shutdown();
+    watching = TRUE;
+    return TRUE;
+}
+
+void watch_shutdown(void) {
+    for (int i = 0; i < dir_count; ++i) free(dirs[i].entries);
+    memset(dirs, 0, sizeof(dirs));
+    dir_count = 0;
+    pending_count = pending_pos = 0;
+    watching = FALSE;
+}
+
+int watch_dir(const char* dir) {
+    if (!watching || dir_count >= WATCH_MAX_DIRS) return FALSE;
+    snprintf(dirs[dir_count].path, sizeof(dirs[dir_count].path), "%s", dir);
+    scan_dir(dir_count++, FALSE);
+    return TRUE;
+}
+
+int watch_next(char* path, size_t size) {
+    if (!watching) return FALSE;
+    if (pending_pos >= pending_count) {
+        pending_count = pending_pos = 0;
+        if (!SDL_TICKS_PASSED(SDL_GetTicks(), next_scan)) return FALSE;
+        next_scan = SDL_GetTicks() + WATCH_POLL_MS;
+        for (int i = 0; i < dir_count; ++i) scan_dir(i, TRUE);
+        if (pending_count == 0) return FALSE;
+    }
+    snprintf(path, size, "%s", pending[pending_pos++]);
+    return TRUE;
+}
+#endif
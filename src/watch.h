@@ -0,0 +1,17 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stddef.h>
+
+// Changed-file notifications for hot reloading levels and assets. Directories are watched,
+// not single files, so editors that save by writing a new file and renaming it over the old
+// one are seen too. Linux uses inotify; elsewhere the directories are rescanned for newer
+// modification times every WATCH_POLL_MS.
+int watch_init(void);
+void watch_shutdown(void);
+// watch the files directly inside dir
+int watch_dir(const char* dir);
+// next file ("dir/name") written since the last call; FALSE when there is none. Never blocks.
+int watch_next(char* path, size_t size);
+
+#endif
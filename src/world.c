@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./level.h"
+#include "./world.h"
+
+World world;
+
+static void spawn_link(int s, int chunk) {
+    WorldSpawn* sp = &world.spawns[s];
+    sp->chunk = chunk;
+    sp->prev = -1;
+    sp->next = chunk >= 0 ? world.spawn_head[chunk] : -1;
+    if (chunk < 0) return;
+    if (sp->next >= 0) world.spawns[sp->next].prev = s;
+    world.spawn_head[chunk] = s;
+}
+
+static void spawn_unlink(int s) {
+    WorldSpawn* sp = &world.spawns[s];
+    if (sp->chunk < 0) return;
+    if (sp->prev >= 0) world.spawns[sp->prev].next = sp->next;
+    else world.spawn_head[sp->chunk] = sp->next;
+    if (sp->next >= 0) world.spawns[sp->next].prev = sp->prev;
+    sp->chunk = -1;
+}
+
+// chunks needed to cover n tiles (at least one)
+static int chunk_span(int n) {
+    int chunks = (n + WORLD_CHUNK_TILES - 1) / WORLD_CHUNK_TILES;
+    return chunks < 1 ? 1 : chunks;
+}
+
+int world_chunk_count(int rows, int cols) { return chunk_span(rows) * chunk_span(cols); }
+
+int world_init(const LevelData* lv, const uint16_t* remap, int radius) {
+    world_free();
+    world.level = lv;
+    world.rows = lv->rows; world.cols = lv->cols;
+    world.chunk_rows = chunk_span(lv->rows);
+    world.chunk_cols = chunk_span(lv->cols);
+    world.radius = radius < 0 ? 0 : radius;
+    world.center_cr = world.center_cc = -1;
+    world.cr0 = world.cc0 = 0; world.cr1 = world.cc1 = -1;
+    // the window never holds more than (2r+1)^2 chunks
+    int side = 2 * world.radius + 1;
+    world.slot_count = side * side;
+    size_t chunks = (size_t)world.chunk_rows * world.chunk_cols;
+    world.directory = malloc(sizeof(int) * chunks);
+    world.spawn_head = malloc(sizeof(int) * chunks);
+    world.slots = calloc((size_t)world.slot_count, sizeof(WorldChunk));
+    world.remap = malloc(sizeof(uint16_t) * (size_t)lv->token_count);
+    world.spawns = calloc((size_t)lv->npc_count + 1, sizeof(WorldSpawn));
+    if (!world.directory || !world.spawn_head || !world.slots || !world.remap || !world.spawns) { world_free(); return FALSE; }
+    for (size_t i = 0; i < chunks; ++i) { world.directory[i] = -1; world.spawn_head[i] = -1; }
+    for (int i = 0; i < world.slot_count; ++i) { world.slots[i].cr = world.slots[i].cc = -1; world.slots[i].dirty = 1; }
+    memcpy(world.remap, remap, sizeof(uint16_t) * (size_t)lv->token_count);
+
+    world.hostiles_alive = 0;
+    for (int i = 0; i < lv->npc_count; ++i) {
+        const LevelNpcSpawn* s = &lv->npcs[i];
+        WorldSpawn* sp = &world.spawns[i];
+        sp->x = (float)(s->col * TILE_SIZE); sp->y = (float)(s->row * TILE_SIZE);
+        sp->hp = s->hp;
+        sp->alive = 1; sp->active = 0;
+        sp->chunk = -1;
+        spawn_link(i, world_chunk_at(sp->x, sp->y));
+        if (s->hostile) world.hostiles_alive++;
+    }
+    return TRUE;
+}
+
+void world_free(void) {
+    for (int i = 0; i < world.slot_count; ++i) if (world.slots[i].tex) SDL_DestroyTexture(world.slots[i].tex);
+    free(world.directory); free(world.spawn_head); free(world.slots); free(world.remap); free(world.spawns);
+    memset(&world, 0, sizeof(world));
+    world.cr1 = world.cc1 = -1;
+}
+
+int world_spawns_valid(const WorldSpawn* spawns, int count, const int* head, int chunks) {
+    int listed = 0, linked = 0;
+    for (int k = 0; k < count; ++k) {
+        const WorldSpawn* sp = &spawns[k];
+        if (sp->chunk < -1 || sp->chunk >= chunks || sp->next < -1 || sp->next >= count || sp->prev < -1 || sp->prev >= count) return FALSE;
+        linked += sp->chunk >= 0;
+    }
+    // walking every list reaches each linked record exactly once
+    for (int c = 0; c < chunks; ++c) {
+        int prev = -1;
+        for (int k = head[c]; k != -1; prev = k, k = spawns[k].next) {
+            if (k < 0 || k >= count || spawns[k].chunk != c || spawns[k].prev != prev || ++listed > linked) return FALSE;
+        }
+    }
+    return listed == linked;
+}
+
+int world_chunk_at(float x, float y) {
+    if (x < 0 || y < 0) return -1;
+    int r = (int)(y / TILE_SIZE), c = (int)(x / TILE_SIZE);
+    if (r >= world.rows || c >= world.cols) return -1;
+    return (r / WORLD_CHUNK_TILES) * world.chunk_cols + c / WORLD_CHUNK_TILES;
+}
+
+void world_spawn_relink(int spawn, int chunk) {
+    if (spawn < 0 || spawn >= world.level->npc_count || world.spawns[spawn].chunk == chunk) return;
+    spawn_unlink(spawn);
+    spawn_link(spawn, chunk);
+}
+
+void world_spawn_kill(int spawn) {
+    if (spawn < 0 || spawn >= world.level->npc_count || !world.spawns[spawn].alive) return;
+    world.spawns[spawn].alive = 0;
+    world.spawns[spawn].active = 0;
+    spawn_unlink(spawn);
+    if (world.level->npcs[spawn].hostile) world.hostiles_alive--;
+}
+
+// copy one chunk of the level into a slot: runtime tile ids and collision bits
+static void fill_chunk(WorldChunk* ch, int cr, int cc) {
+    const LevelData* lv = world.level;
+    memset(ch->tiles, 0, sizeof(ch->tiles));
+    memset(ch->solid, 0, sizeof(ch->solid));
+    int r0 = cr * WORLD_CHUNK_TILES, c0 = cc * WORLD_CHUNK_TILES;
+    int rn = lv->rows - r0 < WORLD_CHUNK_TILES ? lv->rows - r0 : WORLD_CHUNK_TILES;
+    int cn = lv->cols - c0 < WORLD_CHUNK_TILES ? lv->cols - c0 : WORLD_CHUNK_TILES;
+    for (int r = 0; r < rn; ++r) {
+        const uint16_t* src = lv->tiles + (size_t)(r0 + r) * lv->cols + c0;
+        uint16_t* dst = ch->tiles + r * WORLD_CHUNK_TILES;
+        uint32_t bits = 0;
+        for (int c = 0; c < cn; ++c) {
+            dst[c] = src[c] < lv->token_count ? world.remap[src[c]] : 0;
+            bits |= (uint32_t)level_is_solid(lv, r0 + r, c0 + c) << c;
+        }
+        // cells past the world edge are solid too
+        if (cn < WORLD_CHUNK_TILES) bits |= ~0u << cn;
+        ch->solid[r] = bits;
+    }
+    for (int r = rn; r < WORLD_CHUNK_TILES; ++r) ch->solid[r] = ~0u;
+    ch->cr = cr; ch->cc = cc;
+    ch->dirty = 1;
+}
+
+int world_patch(const LevelData* lv, const uint16_t* remap, const int* spawn_from, WorldChunkFn on_patch) {
+    if (lv->rows != world.rows || lv->cols != world.cols) return -1;
+    uint16_t* new_remap = malloc(sizeof(uint16_t) * (size_t)lv->token_count);
+    WorldSpawn* spawns = calloc((size_t)lv->npc_count + 1, sizeof(WorldSpawn));
+    if (!new_remap || !spawns) { free(new_remap); free(spawns); return -1; }
+    memcpy(new_remap, remap, sizeof(uint16_t) * (size_t)lv->token_count);
+    free(world.remap);
+    world.remap = new_remap;
+
+    // carry the spawn states over and relink every list from scratch
+    WorldSpawn* old = world.spawns;
+    world.spawns = spawns;
+    world.level = lv;
+    for (int i = 0; i < world.chunk_rows * world.chunk_cols; ++i) world.spawn_head[i] = -1;
+    world.hostiles_alive = 0;
+    for (int k = 0; k < lv->npc_count; ++k) {
+        const LevelNpcSpawn* s = &lv->npcs[k];
+        WorldSpawn* sp = &spawns[k];
+        if (spawn_from[k] >= 0) *sp = old[spawn_from[k]];
+        else {
+            sp->x = (float)(s->col * TILE_SIZE); sp->y = (float)(s->row * TILE_SIZE);
+            sp->hp = s->hp;
+            sp->alive = 1; sp->active = 0;
+            sp->chunk = world_chunk_at(sp->x, sp->y);
+        }
+        int chunk = sp->chunk;
+        sp->chunk = -1;
+        if (!sp->alive) continue;
+        spawn_link(k, chunk);
+        if (s->hostile) world.hostiles_alive++;
+    }
+    free(old);
+
+    int patched = 0;
+    WorldChunk fresh;
+    for (int i = 0; i < world.slot_count; ++i) {
+        WorldChunk* ch = &world.slots[i];
+        if (ch->cr < 0) continue;
+        fill_chunk(&fresh, ch->cr, ch->cc);
+        if (memcmp(fresh.tiles, ch->tiles, sizeof(ch->tiles)) == 0 && memcmp(fresh.solid, ch->solid, sizeof(ch->solid)) == 0) continue;
+        memcpy(ch->tiles, fresh.tiles, sizeof(ch->tiles));
+        memcpy(ch->solid, fresh.solid, sizeof(ch->solid));
+        ch->dirty = 1;
+        patched++;
+        if (on_patch) on_patch(i);
+    }
+    return patched;
+}
+
+int world_set_center(int center_cr, int center_cc, WorldChunkFn on_evict, WorldChunkFn on_load) {
+    if (center_cr < 0) center_cr = 0;
+    if (center_cc < 0) center_cc = 0;
+    if (center_cr >= world.chunk_rows) center_cr = world.chunk_rows - 1;
+    if (center_cc >= world.chunk_cols) center_cc = world.chunk_cols - 1;
+    if (center_cr == world.center_cr && center_cc == world.center_cc) return FALSE;
+    int cr0 = center_cr - world.radius, cr1 = center_cr + world.radius;
+    int cc0 = center_cc - world.radius, cc1 = center_cc + world.radius;
+    if (cr0 < 0) cr0 = 0;
+    if (cc0 < 0) cc0 = 0;
+    if (cr1 >= world.chunk_rows) cr1 = world.chunk_rows - 1;
+    if (cc1 >= world.chunk_cols) cc1 = world.chunk_cols - 1;
+
+    // evict chunks that fell out of the window
+    for (int i = 0; i < world.slot_count; ++i) {
+        WorldChunk* ch = &world.slots[i];
+        if (ch->cr < 0) continue;
+        if (ch->cr >= cr0 && ch->cr <= cr1 && ch->cc >= cc0 && ch->cc <= cc1) continue;
+        if (on_evict) on_evict(i);
+        world.directory[ch->cr * world.chunk_cols + ch->cc] = -1;
+        ch->cr = ch->cc = -1;
+    }
+    // load the chunks that came into it, reusing free slots
+    int free_slot = 0;
+    for (int cr = cr0; cr <= cr1; ++cr) {
+        for (int cc = cc0; cc <= cc1; ++cc) {
+            int idx = cr * world.chunk_cols + cc;
+            if (world.directory[idx] >= 0) continue;
+            while (free_slot < world.slot_count && world.slots[free_slot].cr >= 0) free_slot++;
+            if (free_slot >= world.slot_count) break; // cannot happen: the window fits the pool
+            fill_chunk(&world.slots[free_slot], cr, cc);
+            world.directory[idx] = free_slot;
+            if (on_load) on_load(free_slot);
+        }
+    }
+    world.center_cr = center_cr; world.center_cc = center_cc;
+    world.cr0 = cr0; world.cc0 = cc0; world.cr1 = cr1; world.cc1 = cc1;
+    return TRUE;
+}
+
+// collision bits of row r for columns [c0, c1] of one chunk (bit 0 = c0); all set when the
+// chunk is not resident
+static uint32_t chunk_row_bits(int r, int c0, int c1) {
+    const WorldChunk* ch = world_chunk_for_tile(r, c0);
+    int n = c1 - c0 + 1;
+    uint32_t bits = ch ? ch->solid[r % WORLD_CHUNK_TILES] >> (c0 % WORLD_CHUNK_TILES) : ~0u;
+    return n >= 32 ? bits : bits & ((1u << n) - 1u);
+}
+
+static int lowest_bit(uint32_t v) {
+#if defined(__GNUC__)
+    return __builtin_ctz(v);
+#else
+    int i = 0; while (!(v & 1u)) { v >>= 1; ++i; } return i;
+#endif
+}
+
+static int highest_bit(uint32_t v) {
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(v);
+#else
+    int i = 31; while (!(v & 0x80000000u)) { v <<= 1; --i; } return i;
+#endif
+}
+
+#define NO_SOLID INT_MIN // row_first_solid found nothing (-1 is a real, out-of-world column)
+
+// first solid column of row r between c_from and c_to inclusive, scanning from c_from
+// (either direction); NO_SOLID if none. Rows and columns outside the world are solid.
+static int row_first_solid(int r, int c_from, int c_to) {
+    if (r < 0 || r >= world.rows) return c_from;
+    int step = c_to >= c_from ? 1 : -1;
+    int c = c_from;
+    for (;;) {
+        if (c < 0 || c >= world.cols) return c;
+        // the rest of the span inside this chunk, as one word
+        int chunk_lo = c - c % WORLD_CHUNK_TILES, chunk_hi = chunk_lo + WORLD_CHUNK_TILES - 1;
+        if (chunk_hi >= world.cols) chunk_hi = world.cols - 1;
+        int lo, hi;
+        if (step > 0) { lo = c; hi = c_to < chunk_hi ? c_to : chunk_hi; }
+        else { hi = c; lo = c_to > chunk_lo ? c_to : chunk_lo; }
+        uint32_t bits = chunk_row_bits(r, lo, hi);
+        if (bits) return step > 0 ? lo + lowest_bit(bits) : lo + highest_bit(bits);
+        if (step > 0 ? hi >= c_to : lo <= c_to) return NO_SOLID;
+        c = step > 0 ? hi + 1 : lo - 1;
+    }
+}
+
+int world_rect_solid(float x, float y, float w, float h) {
+    int left = (int)floorf(x / TILE_SIZE), right = (int)floorf((x + w - 1) / TILE_SIZE);
+    int top = (int)floorf(y / TILE_SIZE), bottom = (int)floorf((y + h - 1) / TILE_SIZE);
+    for (int r = top; r <= bottom; ++r) if (row_first_solid(r, left, right) != NO_SOLID) return 1;
+    return 0;
+}
+
+WorldMove world_move_and_slide(float x, float y, float w, float h, float dx, float dy) {
+    WorldMove m = { x, y, 0, 0 };
+    // X: the columns the leading edge enters, for every row the box covers
+    if (dx != 0.0f) {
+        int top = (int)floorf(y / TILE_SIZE), bottom = (int)floorf((y + h - 1) / TILE_SIZE);
+        int c_from, c_to;
+        if (dx > 0) { c_from = (int)floorf((x + w - 1) / TILE_SIZE) + 1; c_to = (int)floorf((x + dx + w - 1) / TILE_SIZE); }
+        else { c_from = (int)floorf(x / TILE_SIZE) - 1; c_to = (int)floorf((x + dx) / TILE_SIZE); }
+        int hit = NO_SOLID;
+        if (dx > 0 ? c_to >= c_from : c_to <= c_from) {
+            for (int r = top; r <= bottom; ++r) {
+                int c = row_first_solid(r, c_from, c_to);
+                if (c != NO_SOLID && (hit == NO_SOLID || (dx > 0 ? c < hit : c > hit))) hit = c;
+            }
+        }
+        if (hit != NO_SOLID) { m.x = dx > 0 ? (float)(hit * TILE_SIZE) - w : (float)((hit + 1) * TILE_SIZE); m.hit_x = 1; }
+        else m.x = x + dx;
+    }
+    // Y: the rows the leading edge enters, over the columns the box covers after the X move
+    if (dy != 0.0f) {
+        int left = (int)floorf(m.x / TILE_SIZE), right = (int)floorf((m.x + w - 1) / TILE_SIZE);
+        int r_from, r_to;
+        if (dy > 0) { r_from = (int)floorf((y + h - 1) / TILE_SIZE) + 1; r_to = (int)floorf((y + dy + h - 1) / TILE_SIZE); }
+        else { r_from = (int)floorf(y / TILE_SIZE) - 1; r_to = (int)floorf((y + dy) / TILE_SIZE); }
+        int step = dy > 0 ? 1 : -1, hit = NO_SOLID;
+        if (dy > 0 ? r_to >= r_from : r_to <= r_from) {
+            for (int r = r_from; ; r += step) {
+                if (row_first_solid(r, left, right) != NO_SOLID) { hit = r; break; }
+                if (r == r_to) break;
+            }
+        }
+        if (hit != NO_SOLID) { m.y = dy > 0 ? (float)(hit * TILE_SIZE) - h : (float)((hit + 1) * TILE_SIZE); m.hit_y = 1; }
+        else m.y = y + dy;
+    }
+    return m;
+}
@@ -0,0 +1,108 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "./constants.h"
+#include "./level.h"
+
+// The map is split into WORLD_CHUNK_TILES x WORLD_CHUNK_TILES chunks. Only the chunks within
+// the residency radius of the player are kept in memory (tile ids, collision bits, baked
+// texture); the level file stays open and chunks are copied out of it as they come in range.
+typedef struct {
+    int cr, cc; // chunk coordinates, -1 when the slot is free
+    uint16_t tiles[WORLD_CHUNK_TILES * WORLD_CHUNK_TILES]; // runtime tile ids
+    uint32_t solid[WORLD_CHUNK_TILES]; // bit c of word r: tile (r,c) blocks movement
+    SDL_Texture* tex; // baked static layer, created on first draw
+    int dirty;        // tex needs re-baking
+} WorldChunk;
+
+// per level NPC spawn record state. Records are linked into per-chunk lists by the chunk
+// the NPC was last seen in, so loading a chunk spawns exactly the NPCs that belong there.
+typedef struct {
+    float x, y;
+    int hp;
+    uint8_t alive;  // not killed yet
+    uint8_t active; // currently spawned into the NPC store
+    int chunk;      // chunk index of the list this record is in
+    int next, prev;
+} WorldSpawn;
+
+typedef struct {
+    int rows, cols;             // world size in tiles
+    int chunk_rows, chunk_cols; // world size in chunks
+    int radius;                 // residency radius in chunks
+    int center_cr, center_cc;   // chunk the window is centered on
+    int cr0, cc0, cr1, cc1;     // resident chunk window (inclusive); empty when cr1 < cr0
+    int* directory;             // per chunk: resident slot, -1 = not resident
+    WorldChunk* slots;
+    int slot_count;
+    const LevelData* level;
+    uint16_t* remap;            // level token index -> runtime tile id
+    WorldSpawn* spawns;         // parallel to level->npcs
+    int* spawn_head;            // per chunk: first spawn record, -1 = none
+    int hostiles_alive;         // hostile NPCs not killed yet, resident or not
+} World;
+
+extern World world;
+
+// set up an empty window over a level; remap has level->token_count entries
+int world_init(const LevelData* lv, const uint16_t* remap, int radius);
+void world_free(void);
+
+typedef void (*WorldChunkFn)(int slot);
+// move the resident window to the chunks around (center_cr, center_cc). on_evict runs before
+// a chunk's data is dropped and on_load after it is filled; returns TRUE if the window moved.
+int world_set_center(int center_cr, int center_cc, WorldChunkFn on_evict, WorldChunkFn on_load);
+// switch to an edited version of the level of the same size (hot reload); remap has
+// lv->token_count entries. Spawn record k of lv carries on the state of the old record
+// spawn_from[k] (-1: a new record, not spawned yet). Resident chunks whose tiles or collision
+// changed are refilled in place and marked dirty, and on_patch runs for each; returns how
+// many, -1 if the size differs or memory ran out (the world is unchanged then).
+int world_patch(const LevelData* lv, const uint16_t* remap, const int* spawn_from, WorldChunkFn on_patch);
+// chunks a world of rows x cols tiles is split into (world.chunk_rows * world.chunk_cols)
+int world_chunk_count(int rows, int cols);
+// whether spawn records and per-chunk list heads read back from outside (a snapshot) form
+// well-linked lists: every index in range, each record in the list of its own chunk, no cycles
+int world_spawns_valid(const WorldSpawn* spawns, int count, const int* head, int chunks);
+// chunk index containing a pixel position, -1 outside the world
+int world_chunk_at(float x, float y);
+// move a spawn record to the list of another chunk
+void world_spawn_relink(int spawn, int chunk);
+// a spawned NPC died: it never comes back
+void world_spawn_kill(int spawn);
+
+static inline const WorldChunk* world_chunk_for_tile(int r, int c) {
+    if (r < 0 || c < 0 || r >= world.rows || c >= world.cols) return NULL;
+    int slot = world.directory[(r / WORLD_CHUNK_TILES) * world.chunk_cols + c / WORLD_CHUNK_TILES];
+    return slot >= 0 ? &world.slots[slot] : NULL;
+}
+
+// tile id at (r,c); TILE_NONE (0) when outside the world or not resident
+static inline uint16_t world_tile(int r, int c) {
+    const WorldChunk* ch = world_chunk_for_tile(r, c);
+    return ch ? ch->tiles[(r % WORLD_CHUNK_TILES) * WORLD_CHUNK_TILES + c % WORLD_CHUNK_TILES] : 0;
+}
+
+// whether (r,c) blocks movement; outside the world and non-resident chunks are solid
+static inline int world_solid(int r, int c) {
+    const WorldChunk* ch = world_chunk_for_tile(r, c);
+    return ch ? (int)((ch->solid[r % WORLD_CHUNK_TILES] >> (c % WORLD_CHUNK_TILES)) & 1u) : 1;
+}
+
+// any solid tile under the pixel rectangle (x, y, w, h)? Tests a row's whole span per
+// collision word, so the cost depends on the rows covered, not the columns.
+int world_rect_solid(float x, float y, float w, float h);
+
+typedef struct {
+    float x, y;       // where the box ended up
+    int hit_x, hit_y; // movement on that axis was stopped by a solid tile
+} WorldMove;
+
+// move a w x h box at (x, y) by (dx, dy), X first, then Y from the new X. Each axis sweeps every
+// tile column/row the leading edge crosses, so a large step cannot tunnel through a wall; a
+// blocked axis stops flush against the wall while the other keeps moving (slide). Tiles the
+// box already overlaps do not block, so anything stuck in a wall can move out of it.
+WorldMove world_move_and_slide(float x, float y, float w, float h, float dx, float dy);
+
+#endif